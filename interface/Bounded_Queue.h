@@ -0,0 +1,140 @@
+#ifndef BOUNDED_QUEUE
+#define BOUNDED_QUEUE
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace hitfit {
+
+  // Bounded single-producer / single-consumer queue.
+  //
+  // The slots are allocated once and recycled: the producer fills the
+  // slot returned by write_slot() and publishes it with push(), the
+  // consumer reads the slot returned by read_slot() and releases it with
+  // pop().  Neither side takes a lock; each index is written by one side
+  // only and published with release/acquire ordering.
+  //
+  // The blocking calls spin with yield() while the queue is full (empty)
+  // and count how often they had to wait, next to the occupancy seen at
+  // each push, so that a starved or a blocked stage can be spotted.
+  template <class T>
+  class Bounded_Queue {
+
+  public:
+
+    explicit Bounded_Queue(size_t capacity)
+      : _slots(capacity + 1),
+        _head(0),
+        _tail(0),
+        _closed(false),
+        _npush(0),
+        _occupancy_sum(0),
+        _max_occupancy(0),
+        _full_waits(0),
+        _empty_waits(0)
+    {
+    }
+
+    size_t capacity() const { return _slots.size() - 1; }
+
+    // Producer side.
+
+    // Wait for a free slot and return it, to be filled then push()ed.
+    T& write_slot()
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      size_t next = advance(tail);
+      if (next == _head.load(std::memory_order_acquire)) {
+	++_full_waits;
+	while (next == _head.load(std::memory_order_acquire))
+	  std::this_thread::yield();
+      }
+      return _slots[tail];
+    }
+
+    void push()
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      size_t occupancy = size_from(_head.load(std::memory_order_acquire), tail) + 1;
+      _occupancy_sum += occupancy;
+      if (occupancy > _max_occupancy) _max_occupancy = occupancy;
+      ++_npush;
+      _tail.store(advance(tail), std::memory_order_release);
+    }
+
+    // No more push() will follow.
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    // Consumer side.
+
+    // Wait for a filled slot and return it, or 0 once the queue is
+    // empty and closed.
+    T* read_slot()
+    {
+      size_t head = _head.load(std::memory_order_relaxed);
+      bool waited = false;
+      for (;;) {
+	if (head != _tail.load(std::memory_order_acquire))
+	  return &_slots[head];
+	if (_closed.load(std::memory_order_acquire) &&
+	    head == _tail.load(std::memory_order_acquire))
+	  return 0;
+	if (!waited) {
+	  ++_empty_waits;
+	  waited = true;
+	}
+	std::this_thread::yield();
+      }
+    }
+
+    void pop()
+    {
+      _head.store(advance(_head.load(std::memory_order_relaxed)),
+		  std::memory_order_release);
+    }
+
+    // Statistics; the push and full counts are maintained by the
+    // producer, the empty count by the consumer.  Read them once both
+    // sides are done.
+    unsigned long npush() const { return _npush; }
+
+    double mean_occupancy() const
+    {
+      return _npush ? double(_occupancy_sum) / _npush : 0.;
+    }
+
+    size_t max_occupancy() const { return _max_occupancy; }
+
+    unsigned long full_waits() const { return _full_waits; }
+
+    unsigned long empty_waits() const { return _empty_waits; }
+
+  private:
+
+    size_t advance(size_t i) const { return i + 1 == _slots.size() ? 0 : i + 1; }
+
+    size_t size_from(size_t head, size_t tail) const
+    {
+      return tail >= head ? tail - head : tail + _slots.size() - head;
+    }
+
+    Bounded_Queue(const Bounded_Queue&);
+    Bounded_Queue& operator=(const Bounded_Queue&);
+
+    std::vector<T>      _slots;
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    std::atomic<bool>   _closed;
+
+    unsigned long       _npush;
+    unsigned long       _occupancy_sum;
+    size_t              _max_occupancy;
+    unsigned long       _full_waits;
+    unsigned long       _empty_waits;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BOUNDED_QUEUE
@@ -0,0 +1,161 @@
+//
+// File: hitfit/Compact_Event.h
+// Purpose: Structure-of-arrays form of a Lepjets_Event for the
+//          permutation loop.
+//
+// A Lepjets_Event_Jet carries, next to its four-momentum, a full
+// Vector_Resolution, the SVX/SLT tag flags, the tag lepton, slt_edep
+// and e0; copying an event per permutation copies all of them.  A
+// Compact_Event keeps only what changes between permutations, in
+// contiguous arrays: the four-momenta, the type codes, a resolution
+// index and a tag bit mask; eta and phi are computed from the momenta
+// when asked for, nothing in the loop reads them.  Everything else is left in a
+// source Lepjets_Event holding each object once, which the compact
+// objects refer to by index.  The source is passed in wherever it is
+// needed rather than kept, so that a compact event can be copied with
+// its owner, e.g. with a bpkRunHitFit, without pointing back into the
+// original.
+//
+
+
+/**
+    @file Compact_Event.h
+
+    @brief Structure-of-arrays form of a Lepjets_Event, referring to a
+    source event for the fields not used in the permutation loop.
+
+ */
+
+#ifndef HITFIT_COMPACT_EVENT_H
+#define HITFIT_COMPACT_EVENT_H
+
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event.h"
+#include <vector>
+
+
+namespace hitfit {
+
+
+/**
+    @class Compact_Event
+
+    @brief Leptons and jets of an event as arrays, leptons first.
+
+    Object i was taken from object src(i) of the source event (a lepton
+    for i < nleps(), a jet otherwise), whose resolution it uses; the
+    resolution index is that source index.  The compact event keeps no
+    reference to the source; to_event() must be given the same source
+    it was built from.
+ */
+class Compact_Event
+{
+public:
+  /**
+     Bits of tags().
+   */
+  enum Tag_Bits {
+    svx_tag_bit = 1 << 0,
+    slt_tag_bit = 1 << 1
+  };
+
+  /**
+     @brief Create an empty compact event.
+   */
+  Compact_Event ();
+
+  /**
+     @brief Take all objects of ev, which becomes the source.
+   */
+  void assign (const Lepjets_Event& ev);
+
+  /**
+     @brief Start an empty compact event of source; the missing Et is
+     taken from the source.
+   */
+  void reset (const Lepjets_Event& source);
+
+  /**
+     @brief Add lepton i of source.
+   */
+  void add_lep (const Lepjets_Event& source,
+                std::vector<Lepjets_Event_Lep>::size_type i);
+
+  /**
+     @brief Add jet j of source, with type code type.
+   */
+  void add_jet (const Lepjets_Event& source,
+                std::vector<Lepjets_Event_Jet>::size_type j, int type);
+
+  /**
+     @brief Set the jet types as Lepjets_Event::set_jet_types does.
+
+     @par Return:
+     <b>FALSE</b> if the number of types does not match the number of jets.
+   */
+  bool set_jet_types (const std::vector<int>& jet_types);
+
+  /**
+     @brief Set the four-momentum of object i.
+   */
+  void set_p (std::vector<double>::size_type i, const Fourvec& v);
+
+  /**
+     @brief Take the four-momenta and the missing Et of ev, which has
+     the same objects in the same order, e.g. after a fit.
+   */
+  void set_momenta (const Lepjets_Event& ev);
+
+  /**
+     @brief Rebuild the full event in ev, reusing its storage, from the
+     source this was built from.
+   */
+  void to_event (const Lepjets_Event& source, Lepjets_Event& ev) const;
+
+  /**
+     @brief Put the four-momenta and the missing Et held here back into
+     ev, built by to_event() and changed since in its momenta only, as
+     by a fit; cheaper than rebuilding it.
+   */
+  void restore_momenta (Lepjets_Event& ev) const;
+
+  std::vector<double>::size_type nobjs () const;
+  std::vector<double>::size_type nleps () const;
+  std::vector<double>::size_type njets () const;
+
+  /**
+     @brief Four-momentum of object i.
+   */
+  Fourvec p (std::vector<double>::size_type i) const;
+
+  /**
+     @brief Pseudorapidity and azimuth of object i, from its momentum.
+   */
+  double eta (std::vector<double>::size_type i) const;
+  double phi (std::vector<double>::size_type i) const;
+
+  Fourvec& met ();
+  const Fourvec& met () const;
+
+  // The arrays, indexed by object.
+  std::vector<double>         px;
+  std::vector<double>         py;
+  std::vector<double>         pz;
+  std::vector<double>         e;
+  std::vector<int>            type;
+  std::vector<int>            src;    // source object, and resolution index
+  std::vector<unsigned char>  tags;   // Tag_Bits
+
+
+private:
+  void push (const Lepjets_Event_Lep& obj, int type, int src, unsigned char tags);
+
+  std::vector<double>::size_type _nleps;
+  Fourvec                     _met;
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_COMPACT_EVENT_H
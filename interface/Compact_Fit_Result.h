@@ -0,0 +1,132 @@
+//
+// File: hitfit/Compact_Fit_Result.h
+// Purpose: Fit_Result held as a Compact_Event plus the fit quantities.
+//
+// A Fit_Result holds a full copy of the fitted event, with a
+// Vector_Resolution and the tag information per object; storing one
+// per permutation duplicates the same few resolutions thousands of
+// times.  The fit only changes the four-momenta and the neutrino, so a
+// Compact_Fit_Result keeps the fitted momenta in a Compact_Event, whose
+// objects refer by index to the source event holding each resolution
+// once, and rebuilds the Fit_Result on demand.
+//
+// The results are recycled between events (see Scratch_Vector.h); each
+// holds room for pull_capacity pulls from its creation on, so that a
+// recycled result takes new pulls without allocating.
+//
+
+
+/**
+    @file Compact_Fit_Result.h
+
+    @brief Fit_Result held as a Compact_Event plus the fit quantities.
+
+ */
+
+#ifndef HITFIT_COMPACT_FIT_RESULT_H
+#define HITFIT_COMPACT_FIT_RESULT_H
+
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Event.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/Fit_Result.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/matutil.h"
+
+
+namespace hitfit {
+
+
+/**
+    @class Compact_Fit_Result
+
+    @brief The result of fitting one permutation, with the fitted event
+    in compact form.  As for Compact_Event, the source event is given
+    again to rebuild it.
+ */
+class Compact_Fit_Result
+{
+public:
+  /**
+     @brief Pulls per vector stored without allocating: the fitted
+     variables of a lepton and MAX_HITFIT_JET jets, as MAX_HITFIT_VAR
+     of bpkRunHitFit.h.
+   */
+  static const int pull_capacity = 32;
+
+  /**
+     @brief Create an empty result, with chisq -999.
+   */
+  Compact_Fit_Result ();
+
+  /**
+     @brief Copy r, with room for pull_capacity pulls as a new result.
+   */
+  Compact_Fit_Result (const Compact_Fit_Result& r);
+
+  /**
+     @brief Set the result of the fit of the permutation unfitted, which
+     gave the event fitted; the arguments are those of Fit_Result.
+   */
+  void assign (double chisq,
+               const Compact_Event& unfitted,
+               const Lepjets_Event& fitted,
+               const Column_Vector& pullx,
+               const Column_Vector& pully,
+               double umwhad,
+               double utmass,
+               double mt,
+               double sigmt);
+
+  /**
+     @brief As above, with the fitted event already in compact form.
+   */
+  void assign (double chisq,
+               const Compact_Event& fitted,
+               const Column_Vector& pullx,
+               const Column_Vector& pully,
+               double umwhad,
+               double utmass,
+               double mt,
+               double sigmt);
+
+  /**
+     @brief Rebuild the full result in r from the source event of the
+     fit, using ev as scratch for the fitted event.
+   */
+  void to_result (const Lepjets_Event& source, Fit_Result& r, Lepjets_Event& ev) const;
+
+  /**
+     @brief Replace the pulls, keeping the rest of the result; empty
+     vectors drop them.
+   */
+  void set_pulls (const Column_Vector& pullx, const Column_Vector& pully);
+
+  double chisq () const;
+  double umwhad () const;
+  double utmass () const;
+  double mt () const;
+  double sigmt () const;
+  const Column_Vector& pullx () const;
+  const Column_Vector& pully () const;
+
+  /**
+     @brief The fitted event.
+   */
+  const Compact_Event& ev () const;
+
+
+private:
+  double        _chisq;
+  double        _umwhad;
+  double        _utmass;
+  double        _mt;
+  double        _sigmt;
+  Column_Vector _pullx;
+  Column_Vector _pully;
+  Compact_Event _ev;
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_COMPACT_FIT_RESULT_H
@@ -39,6 +39,7 @@
 
 #include "TopQuarkAnalysis/TopHitFit/interface/Fourvec_Constrainer.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/matutil.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Fit_Hypothesis.h"
 #include <iosfwd>
 
 
@@ -47,6 +48,10 @@ namespace hitfit {
 
 class Defaults;
 class Lepjets_Event;
+class bpkHitFitPerf;
+template <class H> class Constrained_Hypothesis;
+template <class H>
+std::ostream& operator<< (std::ostream& s, const Constrained_Hypothesis<H>& ct);
 
 /**
 
@@ -122,11 +127,14 @@ private:
 
 
 /**
-    @class Constrained_TopGluon
+    @class Constrained_Hypothesis
     @brief Do a constrained kinematic fitting for a
-    \f$t\bar{t}\to\ell + \rm{jets}\f$ event.
+    \f$t\bar{t}\to\ell + \rm{jets}\f$ event, under hypothesis H
+    (see Fit_Hypothesis.h).  Instantiated for TTbar_Hypothesis,
+    TopGluon_Hypothesis and TTH_Hypothesis.
  */
-class Constrained_TopGluon
+template <class H>
+class Constrained_Hypothesis
 //
 // Purpose: Do kinematic fitting for a ttbar -> ljets event.
 //
@@ -137,10 +145,10 @@ public:
   // those objects should be constrained.  To remove a constraint,
   // set the mass to 0.
   /**
-     @brief Constructor, create an instance of the Constrained_TopGluon object
+     @brief Constructor, create an instance of the Constrained_Hypothesis object
      from the arguments object and the mass constraints.
 
-     @param args Argument for this instance of Constrained_TopGluon object.
+     @param args Argument for this instance of Constrained_Hypothesis object.
 
      @param lepw_mass The mass to which the leptonic W should be constrained.
      If this parameter is set to 0, the constraint is skied.
@@ -152,10 +160,10 @@ public:
      If this parameter is set to 0, the constraints is skied.
 
    */
-  Constrained_TopGluon (const Constrained_TopGluon_Args& args,
-                   double lepw_mass,
-                   double hadw_mass,
-                   double top_mass);
+  Constrained_Hypothesis (const Constrained_TopGluon_Args& args,
+                          double lepw_mass,
+                          double hadw_mass,
+                          double top_mass);
 
   // Do a constrained fit.
   /**
@@ -197,8 +205,21 @@ public:
                     Column_Vector& pullx,
                     Column_Vector& pully);
 
+  /**
+     @brief Copy constructor; the copy does no stage accounting, as it
+     may run on another thread.
+   */
+  Constrained_Hypothesis (const Constrained_Hypothesis& other);
+
+  /**
+     @brief Account the import/export and the constrainer of every
+     constrain() call in perf, or nothing if 0 (the default).  Not
+     owned.
+   */
+  void set_perf (bpkHitFitPerf* perf);
+
   // Dump out our state.
-  friend std::ostream& operator<< (std::ostream& s, const Constrained_TopGluon& ct);
+  friend std::ostream& operator<< <> (std::ostream& s, const Constrained_Hypothesis& ct);
 
 
 private:
@@ -213,9 +234,20 @@ private:
      The guy that actually does the work.
    */
   Fourvec_Constrainer _constrainer;
+
+  /**
+     Stage accounting, see set_perf().
+   */
+  bpkHitFitPerf* _perf;
 };
 
 
+/**
+    @brief The excited quark fit, the original Constrained_TopGluon.
+ */
+typedef Constrained_Hypothesis<TopGluon_Hypothesis> Constrained_TopGluon;
+
+
 } // namespace hitfit
 
 
@@ -0,0 +1,71 @@
+#ifndef COUNTER_RANDOM_ENGINE
+#define COUNTER_RANDOM_ENGINE
+
+#include <stdint.h>
+#include <string>
+
+#include "CLHEP/Random/RandomEngine.h"
+
+namespace hitfit {
+
+  // Counter-based random engine (Philox4x32-10, Salmon et al., SC11).
+  //
+  // The n-th number of a stream is a fixed function of the stream key
+  // and n, with no state carried from one number to the next.  A stream
+  // is selected by a 64-bit key and a 64-bit stream index; keying by
+  // (event, toy) gives every pseudo-experiment its own stream, so the
+  // numbers a toy sees do not depend on which thread generated it or
+  // on how many toys were generated before it.
+  //
+  // Each block of the generator gives two doubles with 53 random bits,
+  // in the open interval (0, 1).
+  class Counter_Random_Engine : public CLHEP::HepRandomEngine {
+
+  public:
+
+    Counter_Random_Engine(uint64_t key = 0, uint64_t stream = 0);
+
+    virtual ~Counter_Random_Engine();
+
+    // Select stream (key, stream) and rewind it to its first number.
+    void reset(uint64_t key, uint64_t stream);
+
+    uint64_t key() const;
+
+    uint64_t stream() const;
+
+    // Number of doubles drawn from the stream so far.
+    uint64_t position() const;
+
+    virtual double flat();
+
+    virtual void flatArray(const int size, double* vect);
+
+    // The seed is the key; the stream index is the second seed.
+    virtual void setSeed(long seed, int extra = 0);
+
+    virtual void setSeeds(const long* seeds, int extra = 0);
+
+    virtual void saveStatus(const char filename[] = "Counter_Random_Engine.conf") const;
+
+    virtual void restoreStatus(const char filename[] = "Counter_Random_Engine.conf");
+
+    virtual void showStatus() const;
+
+    virtual std::string name() const;
+
+  private:
+
+    void next_block();
+
+    uint64_t _key;
+    uint64_t _stream;
+    uint64_t _block;
+    double   _buffer[2];
+    int      _used;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef COUNTER_RANDOM_ENGINE
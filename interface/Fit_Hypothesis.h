@@ -0,0 +1,123 @@
+//
+// File: hitfit/Fit_Hypothesis.h
+// Purpose: Compile-time description of the event hypotheses fitted by
+//          Hypothesis_Fit and Constrained_Hypothesis.
+//
+// This package started as a copy of TopHitFit's Top_Fit and
+// Constrained_Top, with the gluon labels written into the copies.  The
+// hypothesis is now a template parameter instead: a trait struct naming
+// the jet slots filled by the permutations, the jet types taken into the
+// constrained fit, and the constraints.  Every hypothesis gets its own
+// instantiation of the permutation and fit code, with the type tests
+// resolved at compile time.
+//
+// A hypothesis H provides:
+//   name()             - Short name, for printing.
+//   trace_name()       - Name of the fitter in the trace and rejection
+//                        messages; TopGluon_Fit keeps the text job logs
+//                        are grepped for.
+//   njets              - Number of jet slots.
+//   slots[njets]       - The type codes of the slots, in sorted order;
+//                        the other jets stay isr_label (or unknown_label).
+//   imported(type)     - Whether a jet of that type enters the fit.
+//   add_constraints()  - Set up the constraints of a Fourvec_Constrainer.
+//
+
+
+/**
+    @file Fit_Hypothesis.h
+
+    @brief Trait structs describing the ttbar, t+g and ttH hypotheses.
+
+ */
+
+#ifndef HITFIT_FIT_HYPOTHESIS_H
+#define HITFIT_FIT_HYPOTHESIS_H
+
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event_Jet.h"
+
+
+namespace hitfit {
+
+
+class Fourvec_Constrainer;
+
+
+/**
+    @brief \f$t\bar{t}\to\ell + \rm{jets}\f$, as TopHitFit's Top_Fit:
+    four jet slots, the other jets are not fitted.  Without a top mass
+    and with equal_side the two top masses are constrained to be equal;
+    with a top mass both are constrained to it, and equal_side adds
+    nothing.
+ */
+struct TTbar_Hypothesis
+{
+  enum { njets = 4 };
+  static const int slots[njets];
+
+  static const char* name () { return "ttbar"; }
+  static const char* trace_name () { return "TTbar_Fit"; }
+
+  static bool imported (int type)
+  {
+    return type == lepb_label || type == hadb_label ||
+           type == hadw1_label || type == hadw2_label;
+  }
+
+  static void add_constraints (Fourvec_Constrainer& c, bool equal_side,
+                               double lepw_mass, double hadw_mass, double top_mass);
+};
+
+
+/**
+    @brief Excited quark \f$t^{*}\bar{t}^{*}\to tg\,\bar{t}g\f$: the
+    ttbar slots plus two gluon jets, the t+g masses as fit mass.  All
+    jets but ISR and Higgs jets are fitted.
+ */
+struct TopGluon_Hypothesis
+{
+  enum { njets = 6 };
+  static const int slots[njets];
+
+  static const char* name () { return "t+g"; }
+  static const char* trace_name () { return "TopGluon_Fit"; }
+
+  static bool imported (int type)
+  {
+    return type != isr_label && type != higgs_label;
+  }
+
+  static void add_constraints (Fourvec_Constrainer& c, bool equal_side,
+                               double lepw_mass, double hadw_mass, double top_mass);
+};
+
+
+/**
+    @brief \f$t\bar{t}H\f$, \f$H\to b\bar{b}\f$: the ttbar slots plus two
+    Higgs jets.  No constraint acts on the Higgs jets, so, as for jets
+    outside the hypothesis in TopHitFit, they are not fitted; the fit is
+    that of TTbar_Hypothesis on the permutations of the six slots.
+ */
+struct TTH_Hypothesis
+{
+  enum { njets = 6 };
+  static const int slots[njets];
+
+  static const char* name () { return "ttH"; }
+  static const char* trace_name () { return "TTH_Fit"; }
+
+  static bool imported (int type)
+  {
+    return TTbar_Hypothesis::imported (type);
+  }
+
+  static void add_constraints (Fourvec_Constrainer& c, bool equal_side,
+                               double lepw_mass, double hadw_mass, double top_mass);
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_FIT_HYPOTHESIS_H
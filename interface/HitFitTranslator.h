@@ -1,10 +1,14 @@
 #ifndef HITFITTRANSLATOR
 #define HITFITTRANSLATOR
 
+#include <memory>
+
 #include "TopQuarkAnalysis/TopHitFit/interface/EtaDepResolution.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/Lepjets_Event_Lep.h"
 #include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event_Jet.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/fourvec.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Resolution_Table.h"
 
 class LepInfoBranches;
 class JetInfoBranches;
@@ -26,17 +30,35 @@ namespace hitfit {
 				 int type = hitfit::lepton_label,
 				 bool useObjEmbRes = false);
 
+    Lepjets_Event_Lep operator()(const bpkHitFitLepton& lepton,
+				 int type = hitfit::lepton_label,
+				 bool useObjEmbRes = false);
+
     const EtaDepResolution& electronResolution() const;
     const EtaDepResolution& muonResolution() const;
 
     bool CheckEta(const LepInfoBranches& leptons, const int index) const;
 
+    // The resolutions are looked up in a table holding each eta bin
+    // once, shared by all copies of the translator.
+    const Resolution_Table& resolutionTable() const;
+
+    // Index of the resolution of lepton in resolutionTable(),
+    // -1 if there is none.
+    int ResolutionIndex(const bpkHitFitLepton& lepton) const;
+
 
   private:
 
+    void BuildTable();
+
     EtaDepResolution electronResolution_;
     EtaDepResolution muonResolution_;
 
+    std::shared_ptr<const Resolution_Table> table_;
+    int electronGroup_;
+    int muonGroup_;
+
   }; //class LeptonTranslator
 
 
@@ -59,18 +81,41 @@ namespace hitfit {
 				 int type = hitfit::unknown_label,
 				 bool useObjEmbRes = false);
 
+    Lepjets_Event_Jet operator()(const bpkHitFitJet& jet,
+				 int type = hitfit::unknown_label,
+				 bool useObjEmbRes = false);
+
 
     const EtaDepResolution& udscResolution() const;
     const EtaDepResolution& bResolution() const;
 
     bool CheckEta(const JetInfoBranches& jets, const int index) const;
 
+    // Jet energy scale factors for light and b jets.
+    void SetJES(double jes, double jesB);
+    double jes() const;
+    double jesB() const;
+
+    // The resolutions are looked up in a table holding each eta bin
+    // once, shared by all copies of the translator.
+    const Resolution_Table& resolutionTable() const;
+
+    // Index of the resolution of jet with type code type in
+    // resolutionTable(), -1 if there is none.
+    int ResolutionIndex(const bpkHitFitJet& jet, int type) const;
+
 
   private:
 
+    void BuildTable();
+
     EtaDepResolution udscResolution_;
     EtaDepResolution bResolution_;
 
+    std::shared_ptr<const Resolution_Table> table_;
+    int udscGroup_;
+    int bGroup_;
+
     std::string jetCorrectionLevel_;
     double jes_;
     double jesB_;
@@ -89,8 +134,13 @@ namespace hitfit {
     Fourvec operator() (const EvtInfoBranches& evt,
 			bool useObjEmbRes = false);
 
+    Fourvec operator() (const bpkHitFitInput& evt,
+			bool useObjEmbRes = false);
+
     Resolution KtResolution(const EvtInfoBranches& evt,
 			    bool useObjEmbRes = false) const;
+    Resolution KtResolution(const bpkHitFitInput& evt,
+			    bool useObjEmbRes = false) const;
     Resolution METResolution(const EvtInfoBranches& evt,
 			     bool useObjEmbRes = false) const;
 
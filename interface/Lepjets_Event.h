@@ -257,6 +257,19 @@ public:
    */
   void smear (CLHEP::HepRandomEngine& engine, bool smear_dir = false);
 
+  // Remove all objects, keeping the storage of the object lists.
+  /**
+     @brief Remove all leptons and jets and reset the event state,
+     as if the event had been freshly constructed.  The memory held by
+     the lepton and jet lists is kept, so refilling the event does not
+     allocate.
+
+     @param runnum The new run number.
+
+     @param evnum The new event number.
+   */
+  void clear (int runnum = 0, int evnum = 0);
+
   // Sort according to pt.
   /**
      @brief Sort objects in the event according to their transverse momentum
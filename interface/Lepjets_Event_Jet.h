@@ -243,6 +243,18 @@ char jetTypeChar(int type);
  */
 std::string jetTypeString(int type);
 
+/**
+    @brief Helper function: Encode a jet permutation, given as a list of
+    jet type codes, into a single integer.  Each jet contributes one octal
+    digit, the first jet being the least significant one.  The two
+    hadronic  \f$ W- \f$  jets share the same digit, so that the code
+    identifies the permutation independently of which of the two is
+    labelled hadw1 or hadw2.  Up to ten jets can be encoded.
+
+    @param jet_types The jet type codes in vector form.
+ */
+int jetPermutationCode(const std::vector<int>& jet_types);
+
 /**
     @brief Helper function: Translate jet type code from a list of numbers
     to a string.
@@ -0,0 +1,128 @@
+//
+// File: hitfit/Lepjets_Event_Sums.h
+// Purpose: Per-label four-momentum sums of a Lepjets_Event.
+//
+// Lepjets_Event::sum() rescans all objects on every call, and the
+// decay kinematics (hadronic W, hadronic and leptonic top, top + gluon)
+// and the mass cuts call sum() several times per jet permutation.  This class scans
+// the event once and keeps the sums by type code.
+//
+// The sums are kept next to the event rather than in it: Lepjets_Event
+// has to keep the layout of the TopHitFit class it stands in for.
+//
+
+
+/**
+    @file Lepjets_Event_Sums.h
+
+    @brief Per-label four-momentum sums of a Lepjets_Event, with the
+    decay kinematics derived from them.
+
+ */
+
+#ifndef HITFIT_LEPJETS_EVENT_SUMS_H
+#define HITFIT_LEPJETS_EVENT_SUMS_H
+
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Event.h"
+#include <vector>
+
+
+namespace hitfit {
+
+
+/**
+    @brief Unfitted masses of the decay products of an event.
+ */
+struct Decay_Masses
+{
+  double hadw;     // hadw1 + hadw2
+  double hadt;     // hadronic W + hadb
+  double lept;     // leptons + missing Et + lepb
+  double tg_lep;   // leptonic top + gluon1
+  double tg_had;   // hadronic top + gluon2
+};
+
+
+/**
+    @class Lepjets_Event_Sums
+
+    @brief Four-momentum sums of the objects of a Lepjets_Event by type
+    code, and the missing Et.  The decay quantities follow the
+    definitions of Top_Decaykin.
+
+    The sums are only valid for the event they were last reset() from,
+    with the missing Et of set_met().
+ */
+class Lepjets_Event_Sums
+{
+public:
+  /**
+     @brief Create empty sums.
+   */
+  Lepjets_Event_Sums ();
+
+  /**
+     @brief Sum the objects of ev.
+   */
+  explicit Lepjets_Event_Sums (const Lepjets_Event& ev);
+
+  /**
+     @brief Sum the objects of ev, in one pass.
+   */
+  void reset (const Lepjets_Event& ev);
+
+  /**
+     @brief Sum the objects of ev, in one pass.
+   */
+  void reset (const Compact_Event& ev);
+
+  /**
+     @brief Take a new missing Et, e.g. after the neutrino pz was set.
+   */
+  void set_met (const Fourvec& met);
+
+  /**
+     @brief Sum of all objects with type code type, as Lepjets_Event::sum().
+   */
+  Fourvec sum (int type) const;
+
+  /**
+     @brief Decay kinematics, as Top_Decaykin::hadw(), hadt(), lepw()
+     and lept().
+   */
+  Fourvec hadw () const;
+  Fourvec hadt () const;
+  Fourvec lepw () const;
+  Fourvec lept () const;
+
+  /**
+     @brief All unfitted decay masses at once, sharing the W and top
+     sums between them.
+   */
+  void masses (Decay_Masses& m) const;
+
+  /**
+     @brief All unfitted decay masses of ev, from a single scan of
+     its objects.
+   */
+  static Decay_Masses decay_masses (const Lepjets_Event& ev);
+  static Decay_Masses decay_masses (const Compact_Event& ev);
+
+
+private:
+  // Type codes 0 ... unknown_label have their own sum.
+  enum { n_types = unknown_label + 1 };
+
+  void add (int type, const Fourvec& p);
+
+  Fourvec _sums[n_types];
+  Fourvec _met;
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_LEPJETS_EVENT_SUMS_H
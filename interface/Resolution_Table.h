@@ -0,0 +1,97 @@
+//
+// File: hitfit/Resolution_Table.h
+// Purpose: Lookup table of the eta-binned resolutions of a translator.
+//
+// EtaDepResolution::GetResolution() looks up the eta bin and builds a
+// new Vector_Resolution for every object translated.  A
+// Resolution_Table holds the Vector_Resolution of each eta bin once,
+// for any number of EtaDepResolution groups (e.g. b and light jets),
+// and the translators copy an object's resolution from it instead.
+// This is a lookup cache, not interning: Lepjets_Event_Lep and
+// Lepjets_Event_Jet keep the layout of the TopHitFit classes they are
+// handed to as, so every translated object still holds its own
+// Vector_Resolution by value, and no table index is kept in it.
+// The permutation loop does not copy them per permutation, see
+// Compact_Event.h.  The table does not change once filled, so it can
+// be shared between copies of a translator and between threads.
+//
+
+
+/**
+    @file Resolution_Table.h
+
+    @brief Lookup table of the eta-binned resolutions of a translator.
+
+ */
+
+#ifndef HITFIT_RESOLUTION_TABLE_H
+#define HITFIT_RESOLUTION_TABLE_H
+
+
+#include "TopQuarkAnalysis/TopHitFit/interface/EtaDepResolution.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/EtaDepResElement.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/Vector_Resolution.h"
+#include <vector>
+
+
+namespace hitfit {
+
+
+/**
+    @class Resolution_Table
+
+    @brief The Vector_Resolution of every eta bin of a set of
+    EtaDepResolution objects, each added as one group.
+ */
+class Resolution_Table
+{
+public:
+  typedef std::vector<Vector_Resolution>::size_type size_type;
+
+  /**
+     @brief Create an empty table.
+   */
+  Resolution_Table ();
+
+  /**
+     @brief Add the eta bins of res as a new group.
+
+     @par Return:
+     The group number.
+   */
+  int add (const EtaDepResolution& res);
+
+  /**
+     @brief Index of the entry of group for eta, the first bin that
+     contains eta or has it on an edge, as EtaDepResolution searches.
+
+     @par Return:
+     The index, or -1 if eta is outside all bins of the group.
+   */
+  int index (int group, double eta) const;
+
+  /**
+     @brief The resolution at index i.
+   */
+  const Vector_Resolution& operator[] (size_type i) const;
+
+  /**
+     @brief Number of entries, summed over the groups.
+   */
+  size_type size () const;
+
+  int ngroups () const;
+
+
+private:
+  // Entries of group g are _first[g] .. _first[g+1]-1.
+  std::vector<size_type>         _first;
+  std::vector<EtaDepResElement>  _elements;
+  std::vector<Vector_Resolution> _resolutions;
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_RESOLUTION_TABLE_H
@@ -0,0 +1,249 @@
+//
+// File: hitfit/Scalar_Kinematics.h
+// Purpose: The per-permutation kinematics in front of the constrained
+//          fit, templated on the scalar type.
+//
+// For every jet permutation and neutrino solution, TopGluon_Fit sums
+// the objects by type, solves for the neutrino pz and applies the mass
+// cuts, all on Fourvec in double precision.  Scalar_Event holds the
+// momenta of the objects of an event once, as arrays of a scalar type
+// T, and Scalar_Perm_Kinematics does the work of solve_one_perm() and
+// prepare_solved_perm() from them.  With T = float the momenta take
+// half the memory and twice the vector lanes; the sums, the invariant
+// masses and the discriminant of the neutrino solve, which lose too
+// much to cancellation in single precision, are accumulated in
+// Scalar_Traits<T>::accum_type, i.e. double.
+//
+// The constrained fit itself stays in double: Fourvec_Constrainer works
+// on CLHEP matrices, which have no single-precision form.
+//
+
+
+/**
+    @file Scalar_Kinematics.h
+
+    @brief Object sums, neutrino solve and mass cuts of a jet permutation,
+    templated on the scalar type of the object momenta.
+
+ */
+
+#ifndef HITFIT_SCALAR_KINEMATICS_H
+#define HITFIT_SCALAR_KINEMATICS_H
+
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Event.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/TopGluon_Fit.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace hitfit {
+
+
+/**
+    @brief Accumulation type of a scalar type.
+ */
+template <class T>
+struct Scalar_Traits
+{
+  typedef double accum_type;
+};
+
+
+/**
+    @brief A four-momentum in accumulation precision.
+ */
+template <class A>
+struct Scalar_Sum
+{
+  A x, y, z, e;
+
+  Scalar_Sum () : x (0), y (0), z (0), e (0) {}
+
+  template <class T>
+  void add (T px, T py, T pz, T pe)
+  {
+    x += px; y += py; z += pz; e += pe;
+  }
+
+  void add (const Scalar_Sum& o) { x += o.x; y += o.y; z += o.z; e += o.e; }
+
+  A m2 () const { return e*e - x*x - y*y - z*z; }
+
+  /**
+     @brief The mass, negative for a negative mass squared, as Fourvec::m().
+   */
+  A m () const
+  {
+    A mm = m2 ();
+    return mm < 0 ? -std::sqrt (-mm) : std::sqrt (mm);
+  }
+};
+
+
+/**
+    @class Scalar_Event
+
+    @brief Momenta of the objects of a source event in scalar type T,
+    leptons first, indexed as in Compact_Event: lepton i at i, jet j at
+    nleps() + j.
+ */
+template <class T>
+class Scalar_Event
+{
+public:
+  /**
+     @brief Take the momenta of the leptons, jets and missing Et of ev.
+   */
+  void assign (const Lepjets_Event& ev)
+  {
+    _nleps = ev.nleps ();
+    const std::vector<double>::size_type n = _nleps + ev.njets ();
+    px.resize (n); py.resize (n); pz.resize (n); e.resize (n);
+    for (std::vector<double>::size_type i = 0; i != n; i++) {
+      const Fourvec& p = i < _nleps ? ev.lep (i).p () : ev.jet (i - _nleps).p ();
+      px[i] = T (p.x ()); py[i] = T (p.y ()); pz[i] = T (p.z ()); e[i] = T (p.e ());
+    }
+    metx = T (ev.met ().x ());
+    mety = T (ev.met ().y ());
+  }
+
+  /**
+     @brief Index of object i of a compact event built from the same source.
+   */
+  std::vector<double>::size_type index (const Compact_Event& c,
+                                        std::vector<double>::size_type i) const
+  {
+    return i < c.nleps () ? c.src[i] : _nleps + c.src[i];
+  }
+
+  std::vector<T> px, py, pz, e;
+  T metx, mety;
+
+private:
+  std::vector<double>::size_type _nleps;
+};
+
+
+/**
+    @class Scalar_Perm_Kinematics
+
+    @brief solve_one_perm() and prepare_solved_perm() of TopGluon_Fit for
+    one jet permutation, from a Scalar_Event.  Only the W mass neutrino
+    solution is provided; the solve_nu_tmass option needs the double
+    path.
+ */
+template <class T>
+class Scalar_Perm_Kinematics
+{
+public:
+  typedef typename Scalar_Traits<T>::accum_type accum_type;
+
+  /**
+     @brief Sum the objects of permutation c by type, and solve for the
+     two neutrino pz as Top_Decaykin::solve_nu, the solution of smaller
+     magnitude first.  Complex solutions are replaced by their common
+     real part.
+
+     @par Return:
+     <b>FALSE</b> if the solutions were complex.
+   */
+  bool solve (const Scalar_Event<T>& ev, const Compact_Event& c, double wmass,
+              double& umwhad, double& umthad, double& nuz1, double& nuz2)
+  {
+    *this = Scalar_Perm_Kinematics ();
+    for (std::vector<double>::size_type i = 0; i != c.nobjs (); i++) {
+      const std::vector<double>::size_type k = ev.index (c, i);
+      Scalar_Sum<accum_type>* s = 0;
+      switch (c.type[i]) {
+      case lepb_label:  s = &_lepb;  break;
+      case hadb_label:  s = &_hadb;  break;
+      case hadw1_label: s = &_hadw1; break;
+      case hadw2_label: s = &_hadw2; break;
+      default:          if (i < c.nleps ()) s = &_leps; break;
+      }
+      if (s) s->add (ev.px[k], ev.py[k], ev.pz[k], ev.e[k]);
+    }
+    _metx = ev.metx;
+    _mety = ev.mety;
+
+    Scalar_Sum<accum_type> hadw = _hadw1;
+    hadw.add (_hadw2);
+    Scalar_Sum<accum_type> hadt = hadw;
+    hadt.add (_hadb);
+    umwhad = hadw.m ();
+    umthad = hadt.m ();
+
+    // Top_Decaykin::solve_nu, with the products in single precision
+    // and the discriminant accumulated.
+    const T cx = T (_leps.x), cy = T (_leps.y), cz = T (_leps.z), ce = T (_leps.e);
+    const accum_type alpha = wmass*wmass - _leps.m2 ()
+                           + 2 * (accum_type (cx*_metx) + accum_type (cy*_mety));
+    const accum_type a = 8 * (accum_type (cz)*cz - accum_type (ce)*ce);
+    const accum_type b = 4 * alpha * cz;
+    const accum_type c2 = alpha*alpha
+                        - 4 * accum_type (ce)*ce * (accum_type (_metx)*_metx + accum_type (_mety)*_mety);
+    accum_type d = b*b - 2*a*c2;
+    const bool real = d >= 0;
+    if (!real) d = 0;
+    const accum_type dd = std::sqrt (d);
+    nuz1 = T ((-b + dd) / a);
+    nuz2 = T ((-b - dd) / a);
+    if (std::fabs (nuz1) > std::fabs (nuz2))
+      std::swap (nuz1, nuz2);
+    return real;
+  }
+
+  /**
+     @brief Set the neutrino pz to nuz, massless, and apply the mass cuts
+     of TopGluon_Fit with args; only call after solve().
+
+     @param met The missing Et, returned with pz and energy set.
+
+     @par Return:
+     <b>FALSE</b> if the permutation fails the mass cuts, as
+     TopGluon_Fit::prepare_solved_perm().
+   */
+  bool prepare (double nuz, double umwhad, double umthad, double hadw_mass,
+                const TopGluon_Fit_Args& args, Fourvec& met, double& utmass) const
+  {
+    const T nz = T (nuz);
+    const T ne = std::sqrt (_metx*_metx + _mety*_mety + nz*nz);
+    met.setZ (nz);
+    met.setE (ne);
+
+    Scalar_Sum<accum_type> lept = _leps;
+    lept.add (_metx, _mety, nz, ne);
+    lept.add (_lepb);
+    const double umtlep = lept.m ();
+    utmass = (umthad + umtlep) / 2;
+
+    if (hadw_mass <= 0)
+      return true;
+
+    const double jet_mass_cut = args.jet_mass_cut ();
+    if (_lepb.m () > jet_mass_cut || _hadb.m () > jet_mass_cut ||
+        _hadw1.m () > jet_mass_cut || _hadw2.m () > jet_mass_cut)
+      return false;
+    if (umwhad < args.mwhad_min_cut () || umwhad > args.mwhad_max_cut ())
+      return false;
+    if (std::fabs (umthad - umtlep) > args.mtdiff_max_cut ())
+      return false;
+    return true;
+  }
+
+private:
+  Scalar_Sum<accum_type> _leps;
+  Scalar_Sum<accum_type> _lepb;
+  Scalar_Sum<accum_type> _hadb;
+  Scalar_Sum<accum_type> _hadw1;
+  Scalar_Sum<accum_type> _hadw2;
+  T _metx, _mety;
+};
+
+
+} // namespace hitfit
+
+
+#endif // not HITFIT_SCALAR_KINEMATICS_H
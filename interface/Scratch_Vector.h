@@ -0,0 +1,76 @@
+#ifndef SCRATCH_VECTOR
+#define SCRATCH_VECTOR
+
+#include <vector>
+
+namespace hitfit {
+
+  // A vector whose elements are recycled between events.
+  //
+  // reset() only rewinds the logical size: the elements already held
+  // (and whatever heap memory they own, e.g. the jet list of a
+  // Lepjets_Event) are kept, and push_back() assigns into them.
+  // Once the vector has grown to the largest event seen, filling it
+  // again does not touch the heap as long as T's assignment reuses
+  // its own storage.
+  template <class T>
+  class Scratch_Vector {
+
+  public:
+
+    typedef typename std::vector<T>::size_type      size_type;
+    typedef typename std::vector<T>::iterator       iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    Scratch_Vector() : _size(0) {}
+
+    void reset() { _size = 0; }
+
+    void push_back(const T& x)
+    {
+      if (_size < _store.size()) _store[_size] = x;
+      else                       _store.push_back(x);
+      ++_size;
+    }
+
+    // Append an element and return it for filling in place; a
+    // recycled element keeps its old value until overwritten.
+    T& extend()
+    {
+      if (_size == _store.size()) _store.push_back(T());
+      return _store[_size++];
+    }
+
+    // Drop the last element, keeping its storage.
+    void pop_back() { --_size; }
+
+    size_type size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    // Number of elements held, including the recycled ones.
+    size_type capacity() const { return _store.size(); }
+
+    T&       operator[](size_type i)       { return _store[i]; }
+    const T& operator[](size_type i) const { return _store[i]; }
+
+    T&       back()       { return _store[_size - 1]; }
+    const T& back() const { return _store[_size - 1]; }
+
+    iterator       begin()       { return _store.begin(); }
+    iterator       end()         { return _store.begin() + _size; }
+    const_iterator begin() const { return _store.begin(); }
+    const_iterator end()   const { return _store.begin() + _size; }
+
+    // Copy of the live elements, for the by-value accessors.
+    std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+
+  private:
+
+    std::vector<T> _store;
+    size_type      _size;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef SCRATCH_VECTOR
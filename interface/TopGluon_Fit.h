@@ -39,6 +39,7 @@
 
 
 #include "MyAna/bpkHitFitForExcitedQuark/interface/Constrained_TopGluon.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event_Sums.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/matutil.h"
 #include <iosfwd>
 
@@ -48,6 +49,9 @@ namespace hitfit {
 
 class Lepjets_Event;
 class Fit_Results;
+template <class H> class Hypothesis_Fit;
+template <class H>
+std::ostream& operator<< (std::ostream& s, const Hypothesis_Fit<H>& fitter);
 
 
 //
@@ -240,8 +244,13 @@ private:
     @brief Handle and fit jet permutations of an event.  This is the
     primary interface between user's Lepjets_Event and HitFit kinematic
     fitting algorithm.
+
+    The hypothesis H (see Fit_Hypothesis.h) gives the jet slots of the
+    permutations and the constraints; instantiated for TTbar_Hypothesis,
+    TopGluon_Hypothesis and TTH_Hypothesis, see the typedefs below.
 */
-class TopGluon_Fit
+template <class H>
+class Hypothesis_Fit
 //
 // Purpose: Handle jet permutations.
 //
@@ -265,7 +274,7 @@ public:
      @param top_mass The mass to which the top quark should be constrained to.
      A value of zero means this constraint will be removed.
    */
-  TopGluon_Fit (const TopGluon_Fit_Args& args,
+  Hypothesis_Fit (const TopGluon_Fit_Args& args,
            double lepw_mass,
            double hadw_mass,
            double top_mass);
@@ -303,6 +312,123 @@ public:
                        Column_Vector& pullx,
                        Column_Vector& pully);
 
+  // The two halves of fit_one_perm.
+  /**
+      @brief Set up a single jet permutation for the fit: solve for the
+      neutrino  \f$ p_{z} \f$  and apply the mass cuts.  Nothing done here
+      depends on the mass constraints, so the prepared event can be handed
+      to constrain_one_perm() of several fitters differing only in their
+      constraint masses.
+
+      @param ev Input: The event to fit, Output: the event with the neutrino
+      solution set.
+
+      @param nuz Which neutrino solution to use, as in fit_one_perm().
+
+      @param umwhad The mass of hadronic  \f$ W- \f$ boson before the fit.
+
+      @param utmass The mass of the top quarks before fitting, averaged from
+      the values of leptonic and hadronic top quark mass.
+
+      @par Return:
+      <b>FALSE</b> if the permutation fails the mass cuts and should not
+      be fit.
+   */
+  bool prepare_one_perm (Lepjets_Event& ev,
+                         bool nuz,
+                         double& umwhad,
+                         double& utmass);
+
+  // prepare_one_perm in two steps, for fitting both neutrino solutions
+  // of a permutation without solving for them twice.
+  /**
+      @brief Solve for the two neutrino  \f$ p_{z} \f$  solutions of a jet
+      permutation.  When the solutions are complex both are set to their
+      common real part, and the two fits would be identical.
+
+      @param ev The event to fit, with the object labels assigned.
+
+      @param umwhad The mass of hadronic  \f$ W- \f$ boson before the fit.
+
+      @param umthad The mass of hadronic top quark before the fit.
+
+      @param nuz1 The solution used for <i>nuz</i> = <b>FALSE</b>.
+
+      @param nuz2 The solution used for <i>nuz</i> = <b>TRUE</b>.
+   */
+  void solve_one_perm (const Lepjets_Event& ev,
+                       double& umwhad,
+                       double& umthad,
+                       double& nuz1,
+                       double& nuz2);
+
+  /**
+      @brief The first half of solve_one_perm(): sum the objects of a jet
+      permutation and find its unfitted masses.  Without the
+      <i>solve_nu_tmass</i> option the neutrino solutions do not depend
+      on the jets, and can be taken from an earlier solve_one_perm() of
+      the same event.
+
+      @param ev The event to fit, with the object labels assigned.
+
+      @param umwhad The mass of hadronic  \f$ W- \f$ boson before the fit.
+
+      @param umthad The mass of hadronic top quark before the fit.
+   */
+  void sum_one_perm (const Lepjets_Event& ev,
+                     double& umwhad,
+                     double& umthad);
+
+  /**
+      @brief Finish prepare_one_perm() for one solution found by
+      solve_one_perm().  ev must be the event last passed to
+      solve_one_perm() or sum_one_perm(), or a copy of it; only its
+      neutrino is changed.
+
+      @param ev Input: The event to fit, Output: the event with the neutrino
+      solution set.
+
+      @param nuz The neutrino  \f$ p_{z} \f$  to use.
+
+      @param umwhad The mass of hadronic  \f$ W- \f$ boson before the fit.
+
+      @param umthad The mass of hadronic top quark before the fit.
+
+      @param utmass The mass of the top quarks before fitting, averaged from
+      the values of leptonic and hadronic top quark mass.
+
+      @par Return:
+      <b>FALSE</b> if the permutation fails the mass cuts and should not
+      be fit.
+   */
+  bool prepare_solved_perm (Lepjets_Event& ev,
+                            double nuz,
+                            double umwhad,
+                            double umthad,
+                            double& utmass);
+
+  /**
+      @brief Do the constrained fit of an event set up by prepare_one_perm().
+
+      @param ev Input: The prepared event, Output: the event after the fit.
+
+      @param mt The mass of the top quark after fitting.
+
+      @param sigmt The uncertainty of the mass of the top quark after fitting.
+
+      @param pullx Pull quantities for well-measured variables.
+
+      @param pully Pull quantities for poorly-measured variables.
+
+      @par Return:
+      The fit  \f$ \chi^{2} \f$ , negative if the fit didn't converge.
+   */
+  double constrain_one_perm (Lepjets_Event& ev,
+                             double& mt,
+                             double& sigmt,
+                             Column_Vector& pullx,
+                             Column_Vector& pully);
+
   // Fit all jet permutations in EV.
   /**
      @brief Fit all jets permutations in ev.  This function returns
@@ -315,22 +441,55 @@ public:
   Fit_Results fit (const Lepjets_Event& ev);
 
   // Print.
-  friend std::ostream& operator<< (std::ostream& s, const TopGluon_Fit& fitter);
+  friend std::ostream& operator<< <> (std::ostream& s, const Hypothesis_Fit& fitter);
 
   /**
      @brief Return a constant reference to the fit arguments.
    */
   const TopGluon_Fit_Args& args() const;
 
+  /**
+     @brief Unfitted decay masses of the permutation last prepared by
+     prepare_solved_perm(), with its neutrino solution.
+   */
+  const Decay_Masses& masses() const;
+
+  /**
+     @brief Account the constrained fits in perf, see
+     Constrained_Hypothesis::set_perf().
+   */
+  void set_perf (bpkHitFitPerf* perf);
+
 private:
   // The object state.
   const TopGluon_Fit_Args _args;
-  Constrained_TopGluon _constrainer;
+  Constrained_Hypothesis<H> _constrainer;
   double _lepw_mass;
   double _hadw_mass;
+
+  // Object sums of the event last passed to solve_one_perm()
+  // or sum_one_perm(), and the decay masses taken from them.
+  Lepjets_Event_Sums _sums;
+  Decay_Masses _masses;
 };
 
 
+/**
+    @brief The excited quark fit, the original TopGluon_Fit.
+ */
+typedef Hypothesis_Fit<TopGluon_Hypothesis> TopGluon_Fit;
+
+/**
+    @brief The ttbar fit, as TopHitFit's Top_Fit.
+ */
+typedef Hypothesis_Fit<TTbar_Hypothesis> TTbar_Fit;
+
+/**
+    @brief The ttH fit.
+ */
+typedef Hypothesis_Fit<TTH_Hypothesis> TTH_Fit;
+
+
 } // namespace hitfit
 
 
@@ -0,0 +1,79 @@
+#ifndef BPKHITFITALLOC
+#define BPKHITFITALLOC
+
+#include <iosfwd>
+#include <vector>
+
+namespace hitfit{
+
+  // Heap allocation counting.
+  //
+  // Built with BPKHITFIT_ALLOC_AUDIT defined (e.g. <flags
+  // CPPDEFINES="BPKHITFIT_ALLOC_AUDIT"/> in the BuildFile), the package
+  // replaces the global operator new and delete with versions that
+  // count the allocations and bytes requested by each thread.  This
+  // applies to the whole process, so it is meant for audit builds only;
+  // otherwise the counts stay zero and Enabled() is false.
+  struct bpkHitFitAllocCount {
+    unsigned long allocs;
+    unsigned long bytes;
+
+    // Counts of the calling thread since it started.
+    static bpkHitFitAllocCount Now();
+
+    static bool Enabled();
+  };
+
+  // Peak resident memory of the process so far, and the current one,
+  // in kB; 0 where not known.
+  long bpkHitFitPeakRSS();
+  long bpkHitFitCurrentRSS();
+
+  // Allocation audit of bpkRunHitFit by jet multiplicity, see
+  // bpkRunHitFit::SetAllocAudit().
+  struct bpkHitFitAllocAudit {
+
+    struct Multiplicity {
+      Multiplicity();
+
+      unsigned long events;
+      unsigned long allocs;         // whole event
+      unsigned long bytes;
+      unsigned long loop_allocs;    // permutation loop, without the constrainer
+      unsigned long loop_bytes;
+      long          peak_rss_growth; // kB the process peak grew during these events
+      long          max_rss;         // kB, largest current RSS after one of them
+    };
+
+    bpkHitFitAllocAudit();
+
+    // Indexed by the number of jets.
+    std::vector<Multiplicity> by_njets;
+
+    // Last event.
+    unsigned long last_allocs;
+    unsigned long last_bytes;
+    unsigned long last_loop_allocs;
+    unsigned long last_loop_bytes;
+
+    // Events fitted by a fitter that had already fitted one with at
+    // least as many jets and results, when its buffers should have
+    // their size, and the allocations of their permutation loops.  The
+    // result slots take their pull storage when created (see
+    // Compact_Fit_Result::pull_capacity), so the expected count is 0.
+    unsigned long steady_events;
+    unsigned long steady_loop_allocs;
+
+    // No allocation in the permutation loop once warmed up, as
+    // test/testbpkHitFitAllocAudit asserts.  Trivially true without
+    // BPKHITFIT_ALLOC_AUDIT.
+    bool SteadyStateAllocFree() const;
+
+    void Merge(const bpkHitFitAllocAudit& other);
+
+    std::ostream& dump(std::ostream& s) const;
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITALLOC
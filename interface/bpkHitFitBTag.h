@@ -0,0 +1,85 @@
+#ifndef BPKHITFITBTAG
+#define BPKHITFITBTAG
+
+#include <stdint.h>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+
+namespace hitfit{
+
+  // The b-tag requirement of one event, as compiled by
+  // bpkHitFitBTagPolicy from its jets; bit j stands for jet j.  A
+  // permutation, given by the masks of the jets in its b slots (lepb,
+  // hadb) and in its gluon slots, passes if the number of tagged jets
+  // in the b slots is within [min_tags, max_tags] and no vetoed jet is
+  // in a gluon slot.
+  struct bpkHitFitBTagMask {
+    unsigned tagged;
+    unsigned veto;
+    int      min_tags;
+    int      max_tags;
+
+    bool Accept(unsigned bslots, unsigned gluon_slots) const
+    {
+      if (veto & gluon_slots) return false;
+      int n = 0;
+      for (unsigned t = tagged & bslots ; t; t &= t - 1) n++;
+      return n >= min_tags && n <= max_tags;
+    }
+  };
+
+  // Which permutations of an event are fitted, by the b tags of its
+  // jets, see bpkRunHitFit::SetBTagPolicy().
+  class bpkHitFitBTagPolicy {
+
+  public:
+
+    // How a jet counts as tagged.
+    enum Tagger {
+      TAG_FLAG,           // bpkHitFitJet::isBTag, as set by the caller
+      TAG_DISCRIMINANT    // bpkHitFitJet::BTagDiscr above the threshold
+    };
+
+    // CombinedSecondaryVertex working points, see Threshold().
+    enum WorkingPoint { CSVL, CSVM, CSVT };
+
+    // Number of tagged jets required in the b slots.
+    enum Count {
+      COUNT_DEFAULT,      // at least one, two if the event has two or more
+      COUNT_AT_LEAST,     // at least ntags
+      COUNT_EXACTLY       // exactly ntags
+    };
+
+    // The defaults are the rule the fitter always had.  With gluon_veto
+    // set, no tagged jet may take a gluon slot.
+    bpkHitFitBTagPolicy(Tagger tagger = TAG_FLAG,
+			double threshold = 0.,
+			Count  count = COUNT_DEFAULT,
+			int    ntags = 1,
+			bool   gluon_veto = false);
+
+    // Discriminant cut of a working point: 0.244, 0.679 or 0.898.
+    static double Threshold(WorkingPoint wp);
+
+    bool IsTagged(const bpkHitFitJet& jet) const;
+
+    // The requirement for an event with these jets, at most 32.
+    bpkHitFitBTagMask Compile(const std::vector<bpkHitFitJet>& jets) const;
+
+    // Hash of the settings, for bpkRunHitFit::ConfigHash().
+    uint64_t Hash(uint64_t h) const;
+
+  private:
+
+    Tagger _tagger;
+    double _threshold;
+    Count  _count;
+    int    _ntags;
+    bool   _gluonVeto;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITBTAG
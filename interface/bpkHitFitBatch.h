@@ -0,0 +1,145 @@
+#ifndef BPKHITFITBATCH
+#define BPKHITFITBATCH
+
+#include <atomic>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Scratch_Vector.h"
+
+namespace hitfit{
+
+  // Columnar input of a batch of events, as flat arrays.
+  //
+  // The leptons of event i are the entries lep_offsets[i] ..
+  // lep_offsets[i+1]-1 of the lepton arrays, likewise for the jets;
+  // the offset arrays have nevents+1 entries.  The per-event arrays
+  // have nevents entries.  Nothing is copied, the arrays must stay
+  // valid during Fit().
+  struct bpkHitFitBatchInput {
+    bpkHitFitBatchInput();
+
+    long         nevents;
+    const int*   runnum;
+    const int*   evnum;
+
+    const long*  lep_offsets;
+    const float* lep_px;
+    const float* lep_py;
+    const float* lep_pz;
+    const float* lep_e;
+    const float* lep_eta;
+    const int*   lep_type;      // 11 or 13
+
+    const long*  jet_offsets;
+    const float* jet_px;
+    const float* jet_py;
+    const float* jet_pz;
+    const float* jet_e;
+    const float* jet_eta;
+    const float* jet_pt;
+    const float* jet_ptcorr_l7b;
+    const float* jet_ptcorr_l7uds;
+    const float* jet_ptcorr_l3;
+    const char*  jet_btag;
+    const float* jet_btag_discr;  // may be 0
+
+    const float* met_x;
+    const float* met_y;
+    const float* met;
+  };
+
+  // One fitted permutation, as returned by bpkHitFitBatch.
+  struct bpkHitFitBatchRow {
+    int    code;   // see bpkRunHitFit::PermutationCode()
+    double chi2;
+    double mt;
+    double sigmt;
+    double umwhad;
+    double utmass;
+  };
+
+  // Fit a batch of events on a pool of native threads, each with its own
+  // copy of the fitter; the events are picked up one at a time in
+  // whatever order the threads get to them, and the results of every
+  // event are kept in its own slot, so the output does not depend on
+  // the number of threads.  This is the entry point of the Python
+  // bindings in python/bpkHitFitBatch.py, through the C functions below.
+  class bpkHitFitBatch {
+
+  public:
+
+    bpkHitFitBatch(const bpkRunHitFit& fitter, int nthreads = 1);
+
+    // Fit all events of input; returns the total number of results,
+    // or -1 if the fit of an event threw, the results then being
+    // incomplete.
+    long Fit(const bpkHitFitBatchInput& input, bool useObjRes = false);
+
+    long NumEvents() const;
+
+    const Scratch_Vector<bpkHitFitBatchRow>& GetResults(long i) const;
+
+    // Index of the lowest converged chi2 among the results of event i,
+    // or -1; see bpkRunHitFit::GetBestFit().
+    int GetBest(long i) const;
+
+  private:
+
+    void Worker(int worker);
+
+    void FitOne(int worker, long i);
+
+    bpkHitFitBatch(const bpkHitFitBatch&);
+    bpkHitFitBatch& operator=(const bpkHitFitBatch&);
+
+    std::vector<bpkRunHitFit>                       _fitters;
+    std::vector<bpkHitFitInput>                     _inputs;   // per worker
+    const bpkHitFitBatchInput*                      _input;
+    bool                                            _useObjRes;
+    std::vector< Scratch_Vector<bpkHitFitBatchRow> > _results;
+    std::vector<int>                                _best;
+    std::atomic<long>                               _next_event;
+    std::atomic<bool>                               _failed;
+
+  };
+
+} // namespace hitfit
+
+// C interface for ctypes.  Empty file names select the TopHitFit
+// default resolutions.  bpkHitFitBatch_Fit() returns the total number of
+// results, or -1 on a bad handle or a failed fit; bpkHitFitBatch_Get() then fills
+// offsets (nevents+1 entries), best (nevents entries) and the result
+// columns (that many entries).  Any output pointer may be 0.
+extern "C" {
+
+  void* bpkHitFitBatch_Create(const char* default_file,
+			      double      lepw_mass,
+			      double      hadw_mass,
+			      double      top_mass,
+			      int         nu_solution,
+			      int         nthreads,
+			      const char* electron_resolution,
+			      const char* muon_resolution,
+			      const char* udsc_resolution,
+			      const char* b_resolution,
+			      const char* met_resolution);
+
+  void bpkHitFitBatch_Destroy(void* handle);
+
+  long bpkHitFitBatch_Fit(void* handle, const hitfit::bpkHitFitBatchInput* input, int useObjRes);
+
+  void bpkHitFitBatch_Get(void*   handle,
+			  long*   offsets,
+			  int*    best,
+			  int*    code,
+			  double* chi2,
+			  double* mt,
+			  double* sigmt,
+			  double* umwhad,
+			  double* utmass);
+
+}
+
+#endif // #ifndef BPKHITFITBATCH
@@ -0,0 +1,117 @@
+#ifndef BPKHITFITCACHE
+#define BPKHITFITCACHE
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hitfit{
+
+  // Identity of the fit of one event: the event number, a hash of the
+  // input objects and a hash of the fitter configuration,
+  // see bpkRunHitFit::InputHash() and bpkRunHitFit::ConfigHash().
+  struct bpkHitFitCacheKey {
+    bpkHitFitCacheKey();
+    bpkHitFitCacheKey(int runnum, int evnum, uint64_t input_hash, uint64_t config_hash);
+
+    bool operator==(const bpkHitFitCacheKey& other) const;
+
+    int32_t  runnum;
+    int32_t  evnum;
+    uint64_t input_hash;
+    uint64_t config_hash;
+  };
+
+  // Persistent store of fit results, see bpkRunHitFit::SetCache().
+  //
+  // The file is append-only: a header followed by records, each a
+  // fixed-size record header (key, payload size and checksum) and the
+  // payload.  A key stored twice is found with its last record.  On
+  // opening, the file is memory-mapped and scanned once to index the
+  // records; a record cut short or with a wrong checksum, as left by a
+  // job killed while writing, ends the scan and is cut off, so the job
+  // can be restarted on the same file and skip the events already done.
+  // New records are written with pwrite(), and so survive the process
+  // being killed; Flush() in addition syncs them to disk.
+  //
+  // The records are in the byte order and float format of the machine
+  // writing them; the file is not portable between architectures.
+  //
+  // Find() and Store() lock the cache, so it may be shared by the
+  // fitters of several threads.  Store() and the opening of a writable
+  // cache in addition take an flock() of the file, so several
+  // processes, e.g. the shards of bpkHitFitShardSource, may write to
+  // the same file: each appends after the others' records, but only
+  // finds those present when it opened the file and its own.  The
+  // lock is advisory and may not work on every network file system.
+  class bpkHitFitCache {
+
+  public:
+
+    // Open or create the cache file path; with read_only set, nothing
+    // is stored and an existing file is not touched.
+    explicit bpkHitFitCache(const std::string& path, bool read_only = false);
+
+    ~bpkHitFitCache();
+
+    bool IsOpen() const;
+
+    // Copy the payload of key into payload; false if there is none.
+    bool Find(const bpkHitFitCacheKey& key, std::vector<char>& payload);
+
+    // Append a record for key.
+    void Store(const bpkHitFitCacheKey& key, const std::vector<char>& payload);
+
+    // Sync the records written so far to disk.
+    void Flush();
+
+    // Number of keys in the cache.
+    size_t NumKeys() const;
+
+    // Bytes cut off a damaged end of the file when opening it.
+    uint64_t TruncatedBytes() const;
+
+    // 64-bit FNV-1a hash of n bytes, continuing from h.
+    static const uint64_t HASH_SEED = 14695981039346656037ULL;
+    static uint64_t Hash(const void* data, size_t n, uint64_t h = HASH_SEED);
+
+  private:
+
+    struct KeyHash {
+      size_t operator()(const bpkHitFitCacheKey& key) const;
+    };
+
+    struct Location {
+      uint64_t offset;  // of the payload
+      uint32_t size;
+    };
+
+    // Map and scan the open file; false if it is not a cache file.
+    bool Open();
+
+    void Scan();
+
+    bool Map(uint64_t size);
+
+    void Unmap();
+
+    bpkHitFitCache(const bpkHitFitCache&);
+    bpkHitFitCache& operator=(const bpkHitFitCache&);
+
+    std::string         _path;
+    bool                _read_only;
+    int                 _fd;
+    const char*         _map;
+    uint64_t            _mapped;
+    uint64_t            _end;
+    uint64_t            _truncated;
+    std::unordered_map<bpkHitFitCacheKey, Location, KeyHash> _index;
+    mutable std::mutex  _mutex;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITCACHE
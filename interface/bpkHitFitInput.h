@@ -0,0 +1,70 @@
+#ifndef BPKHITFITINPUT
+#define BPKHITFITINPUT
+
+#include <vector>
+
+class LepInfoBranches;
+class JetInfoBranches;
+class EvtInfoBranches;
+
+namespace hitfit{
+
+  // Self-contained copy of the bprimeKit quantities the fitter reads
+  // for one event.  The bprimeKit branches are overwritten by every
+  // GetEntry(), this record is what is handed between the stages of
+  // bpkHitFitPipeline and what the translators work from.
+  // The values are kept as float, like in the branches, so that the
+  // translation gives bit-identical results either way.
+
+  struct bpkHitFitLepton {
+    float Px, Py, Pz, Energy, Eta;
+    int   LeptonType;
+  };
+
+  // isBTag is the caller's tag decision, BTagDiscr the
+  // CombinedSVBJetTags discriminant (-999 if not available); which one
+  // is used is up to bpkHitFitBTagPolicy.
+  struct bpkHitFitJet {
+    float Px, Py, Pz, Energy, Eta, Pt;
+    float PtCorrL7b, PtCorrL7uds, PtCorrL3;
+    float BTagDiscr;
+    bool  isBTag;
+  };
+
+  struct bpkHitFitInput {
+
+    bpkHitFitInput();
+
+    // Remove all objects, keeping the storage.
+    void clear();
+
+    void AddLepton(const LepInfoBranches& leptons, const int index);
+
+    void AddJet(const JetInfoBranches& jets, const int index, bool isBTag);
+
+    void SetMet(const EvtInfoBranches& evt);
+
+    static bpkHitFitLepton MakeLepton(const LepInfoBranches& leptons, const int index);
+
+    static bpkHitFitJet MakeJet(const JetInfoBranches& jets, const int index, bool isBTag = false);
+
+    int runnum;
+    int evnum;
+
+    // Position of the event in the whole input: the read order in
+    // bpkHitFitPipeline, unless the source sets it, as
+    // bpkHitFitShardSource does.  -1 if unknown.
+    long entry;
+
+    std::vector<bpkHitFitLepton> leptons;
+    std::vector<bpkHitFitJet>    jets;
+
+    float PFMETx;
+    float PFMETy;
+    float PFMET;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITINPUT
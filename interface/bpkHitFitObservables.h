@@ -0,0 +1,121 @@
+#ifndef BPKHITFITOBSERVABLES
+#define BPKHITFITOBSERVABLES
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "TopQuarkAnalysis/TopHitFit/interface/matutil.h"
+
+namespace hitfit{
+
+  class bpkRunHitFit;
+  class Fit_Result;
+
+  // Fixed-binning histogram with summary statistics.
+  // The bins include an underflow (bin 0) and an overflow (bin nbins+1).
+  class bpkHitFitHistogram {
+
+  public:
+
+    bpkHitFitHistogram(int nbins = 100, double lo = 0., double hi = 1.);
+
+    void Fill(double x);
+
+    // Add the contents of other, which must have the same binning.
+    void Merge(const bpkHitFitHistogram& other);
+
+    void Reset();
+
+    int    NumBins() const;
+    double Low() const;
+    double High() const;
+    double BinContent(int bin) const;
+    double BinLowEdge(int bin) const;
+
+    // Statistics of all entries, including under- and overflow.
+    unsigned long Entries() const;
+    double Mean() const;
+    double RMS() const;
+    double Min() const;
+    double Max() const;
+
+  private:
+
+    int                 _nbins;
+    double              _lo;
+    double              _hi;
+    double              _scale;   // bins per unit
+    std::vector<double> _bins;
+    unsigned long       _n;
+    double              _sum;
+    double              _sum2;
+    double              _min;
+    double              _max;
+
+  };
+
+  // Histograms of the fit observables of the best permutation (lowest
+  // converged chi2) of each event, filled straight from the compact
+  // results held by bpkRunHitFit, without rebuilding Fit_Result objects.
+  //
+  // An aggregator is not locked; each thread fills its own, and the
+  // aggregators are merged once the batch is done, as bpkHitFitPipeline
+  // does with SetObservables().
+  class bpkHitFitObservables {
+
+  public:
+
+    enum Observable {
+      chi2,      // best chi2
+      mt,        // fitted top mass
+      sigmt,     // its uncertainty
+      mtg_lep,   // lepton + neutrino + lepb + gluon1
+      mtg_had,   // hadb + hadw1 + hadw2 + gluon2
+      pullx,     // all pullx entries
+      pully,     // all pully entries
+      n_observables
+    };
+
+    // Default binning of every observable.
+    bpkHitFitObservables();
+
+    void SetBinning(Observable obs, int nbins, double lo, double hi);
+
+    // Fill with the results currently held by fitter.
+    void Fill(const bpkRunHitFit& fitter);
+
+    // Fill one event from its best result, 0 if no fit converged,
+    // e.g. from a bpkHitFitOutput.
+    void Fill(const Fit_Result* best);
+
+    // Add the contents of other, which must have the same binning.
+    void Merge(const bpkHitFitObservables& other);
+
+    void Reset();
+
+    const bpkHitFitHistogram& Histogram(Observable obs) const;
+
+    // Events filled, and those with a converged fit.
+    unsigned long NumEvents() const;
+    unsigned long NumConverged() const;
+
+    static const char* Name(Observable obs);
+
+    std::ostream& dump(std::ostream& s) const;
+
+  private:
+
+    void FillBest(double chisq, double top_mass, double top_sigma,
+		  double lep_mass, double had_mass,
+		  const Column_Vector& px, const Column_Vector& py);
+
+    bpkHitFitHistogram  _histograms[n_observables];
+    unsigned long       _nevents;
+    unsigned long       _nconverged;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITOBSERVABLES
@@ -0,0 +1,119 @@
+#ifndef BPKHITFITPERF
+#define BPKHITFITPERF
+
+#include <stdint.h>
+#include <iosfwd>
+
+namespace hitfit{
+
+  // Hardware performance counters of the calling thread, read through
+  // Linux perf_event_open(2) as one group: cycles, instructions, cache
+  // misses and branch mispredictions, user space only.
+  //
+  // Open() fails, and every Read() gives zeros, when the counters are
+  // not available: not Linux, no permission (kernel.perf_event_paranoid
+  // above 2, or a seccomp filter as in most containers), or no PMU, as
+  // in many virtual machines.  A copy is not opened, so that a fitter
+  // copied into a worker thread counts that thread.
+  class bpkHitFitPerfCounters {
+
+  public:
+
+    enum Counter { cycles, instructions, cache_misses, branch_misses, n_counters };
+
+    bpkHitFitPerfCounters();
+    bpkHitFitPerfCounters(const bpkHitFitPerfCounters&);
+    bpkHitFitPerfCounters& operator=(const bpkHitFitPerfCounters&);
+    ~bpkHitFitPerfCounters();
+
+    // Open and start the counters for the calling thread; false if
+    // they are not available.  Only tried once.
+    bool Open();
+
+    bool Available() const;
+
+    // Counts since Open(), scaled up if the kernel had to multiplex
+    // the group with other users of the PMU.
+    void Read(uint64_t values[n_counters]) const;
+
+    static const char* Name(Counter c);
+
+  private:
+
+    void Close();
+
+    int  _fd[n_counters];   // _fd[0] leads the group
+    bool _tried;
+
+  };
+
+  // Time and counters spent in the stages of bpkRunHitFit, for tuning
+  // the fit kernel, see bpkRunHitFit::SetPerfCounters().  Without the
+  // hardware counters only the time is kept.  The heap allocations of
+  // bpkHitFitAllocCount are kept alongside, zero unless counted.
+  class bpkHitFitPerf {
+
+  public:
+
+    enum Stage {
+      translation,     // jet translation and compact source of an event
+      neutrino_solve,  // object sums, neutrino pz and mass cuts of a permutation
+      import_export,   // Lepjets_Event to Fourvec_Event and back
+      constrainer,     // Fourvec_Constrainer iterations
+      n_stages
+    };
+
+    struct Sample {
+      double        seconds;
+      uint64_t      counts[bpkHitFitPerfCounters::n_counters];
+      unsigned long allocs;
+      unsigned long alloc_bytes;
+    };
+
+    bpkHitFitPerf();
+
+    // Read the clock and the counters, opening them on first use.
+    void Take(Sample& s);
+
+    // Add to stage the difference between two samples of this thread,
+    // counting calls calls.
+    void Add(Stage stage, const Sample& from, const Sample& to, unsigned long calls = 1);
+
+    void CountEvent();
+
+    void Merge(const bpkHitFitPerf& other);
+
+    void Reset();
+
+    bool Available() const;
+
+    unsigned long NumEvents() const;
+    unsigned long NumCalls(Stage stage) const;
+    double        Seconds(Stage stage) const;
+    uint64_t      Count(Stage stage, bpkHitFitPerfCounters::Counter c) const;
+    unsigned long Allocs(Stage stage) const;
+    unsigned long AllocBytes(Stage stage) const;
+
+    static const char* Name(Stage stage);
+
+    // Per stage: calls, time and counters per event and per constrained
+    // fit, instructions per cycle, misses per thousand instructions, and
+    // allocations where counted.
+    std::ostream& dump(std::ostream& s) const;
+
+  private:
+
+    bpkHitFitPerfCounters _counters;
+    bool                  _available;  // of this or a merged thread
+    unsigned long         _nevents;
+    unsigned long         _calls[n_stages];
+    double                _seconds[n_stages];
+    uint64_t              _counts[n_stages][bpkHitFitPerfCounters::n_counters];
+    unsigned long         _allocs[n_stages];
+    unsigned long         _allocBytes[n_stages];
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITPERF
@@ -0,0 +1,163 @@
+#ifndef BPKHITFITPIPELINE
+#define BPKHITFITPIPELINE
+
+#include <iosfwd>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Bounded_Queue.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitObservables.h"
+
+namespace hitfit{
+
+  // Results of one event, as handed from the fit stage to the write stage.
+  struct bpkHitFitOutput {
+
+    bpkHitFitOutput();
+
+    // Copy the results currently held by fitter.
+    void Assign(const bpkRunHitFit& fitter, const bpkHitFitInput& input);
+
+    int  runnum;
+    int  evnum;
+    long entry;
+    int  njets;
+    int  best;    // bpkRunHitFit::GetBestFit()
+
+    Scratch_Vector<Fit_Result>  results;
+    Scratch_Vector<int>         codes;
+  };
+
+  // Input stage: decode the next event into input, return false
+  // at the end of the input.
+  class bpkHitFitSource {
+  public:
+    virtual ~bpkHitFitSource() {}
+    virtual bool Next(bpkHitFitInput& input) = 0;
+  };
+
+  // Output stage: called once per event, in input order.
+  class bpkHitFitSink {
+  public:
+    virtual ~bpkHitFitSink() {}
+    virtual void Write(const bpkHitFitOutput& output) = 0;
+  };
+
+  struct bpkHitFitStageStats {
+    bpkHitFitStageStats();
+
+    unsigned long nevents;
+    double        busy_seconds;   // time spent in the stage's own work
+    double        wall_seconds;   // lifetime of the stage's thread
+  };
+
+  struct bpkHitFitQueueStats {
+    bpkHitFitQueueStats();
+
+    unsigned long npush;
+    double        mean_occupancy;
+    unsigned long max_occupancy;
+    unsigned long full_waits;     // producer found the queue full
+    unsigned long empty_waits;    // consumer found the queue empty
+  };
+
+  struct bpkHitFitPipelineStats {
+    bpkHitFitStageStats               read;
+    std::vector<bpkHitFitStageStats>  fit;    // one per fit worker
+    bpkHitFitStageStats               write;
+    std::vector<bpkHitFitQueueStats>  input_queues;
+    std::vector<bpkHitFitQueueStats>  output_queues;
+    double                            wall_seconds;
+    double                            reduce_seconds;  // filling and merging the observables
+
+    std::ostream& dump(std::ostream& s) const;
+  };
+
+  // Streaming read -> translate + fit -> write pipeline around bpkRunHitFit.
+  //
+  // The source and the sink each run on their own thread, the fit stage
+  // on nfit threads, each with its own copy of the fitter.  Event k goes
+  // to fit worker k % nfit through that worker's input queue, and the
+  // write stage collects the results from the output queues in the same
+  // round-robin order, so the sink sees the events in input order and
+  // every queue has a single producer and a single consumer.
+  //
+  // The source and the sink must not share state with each other; when
+  // both do ROOT I/O, ROOT has to be initialised for threads first.
+  class bpkHitFitPipeline {
+
+  public:
+
+    bpkHitFitPipeline(const bpkRunHitFit& fitter,
+		      int                 nfit = 1,
+		      size_t              queue_depth = 16,
+		      bool                useObjRes = false);
+
+    ~bpkHitFitPipeline();
+
+    // Run the whole input through the pipeline; returns once the sink
+    // has seen the last event.
+    void Run(bpkHitFitSource& source, bpkHitFitSink& sink);
+
+    const bpkHitFitPipelineStats& Stats() const;
+
+    // Fill histograms of the fit observables in the fit stage: every
+    // fit worker fills its own copy of observables, without locking,
+    // and the copies are merged at the end of each Run().
+    void SetObservables(const bpkHitFitObservables& observables);
+
+    // Merged observables of the last Run().
+    const bpkHitFitObservables& Observables() const;
+
+    // Deterministic mode.  The events and their results reach the sink
+    // in input order whatever the number of fit workers, but the sums
+    // of the observables depend on which worker filled which event, and
+    // in floating point on the order of the merge.  With on set the
+    // observables are filled in the write stage instead, one event
+    // after the other in input order, from the best result of each
+    // output, so that they do not depend on nfit or on the scheduling;
+    // this moves the filling onto the write thread, and its cost shows
+    // in Stats().reduce_seconds either way.  Set the fitter's own
+    // bpkRunHitFit::SetDeterministic() for the ties in the rankings.
+    void SetDeterministic(bool on);
+
+    // Stage accounting of the fit workers in the last Run(), merged;
+    // empty unless the fitter was set up with
+    // bpkRunHitFit::SetPerfCounters().
+    const bpkHitFitPerf& Perf() const;
+
+    // Allocation audit of the fit workers in the last Run(), merged;
+    // empty unless the fitter was set up with
+    // bpkRunHitFit::SetAllocAudit().
+    const bpkHitFitAllocAudit& AllocAudit() const;
+
+  private:
+
+    void ReadStage(bpkHitFitSource* source);
+    void FitStage(int worker);
+    void WriteStage(bpkHitFitSink* sink);
+
+    bpkHitFitPipeline(const bpkHitFitPipeline&);
+    bpkHitFitPipeline& operator=(const bpkHitFitPipeline&);
+
+    std::vector<bpkRunHitFit>                      _fitters;
+    std::vector<Bounded_Queue<bpkHitFitInput>*>    _inputQueues;
+    std::vector<Bounded_Queue<bpkHitFitOutput>*>   _outputQueues;
+    bool                                           _useObjRes;
+
+    bool                                           _deterministic;
+    bool                                           _fillObservables;
+    std::vector<bpkHitFitObservables>              _workerObservables;
+    std::vector<double>                            _reduceSeconds;  // per fit worker
+    bpkHitFitObservables                           _observables;
+
+    bpkHitFitPipelineStats                         _stats;
+    bpkHitFitPerf                                  _perf;
+    bpkHitFitAllocAudit                            _alloc;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITPIPELINE
@@ -0,0 +1,80 @@
+#ifndef BPKHITFITPRECISION
+#define BPKHITFITPRECISION
+
+#include <iosfwd>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitObservables.h"
+
+namespace hitfit{
+
+  class bpkRunHitFit;
+  struct bpkHitFitInput;
+
+  // Validation of the single-precision mode of bpkRunHitFit (see
+  // SetSinglePrecision()) against the double-precision path: two fitters
+  // with the same settings but the precision fit the same events, and
+  // the report collects the differences of chi2 and mt over the
+  // permutations converged in both, the permutations converged in only
+  // one of them, and how often both pick the same best permutation.
+  //
+  // Like bpkHitFitObservables, a report is not locked; each thread
+  // keeps its own and the reports are merged at the end.
+  class bpkHitFitPrecisionReport {
+
+  public:
+
+    bpkHitFitPrecisionReport();
+
+    // Fit input with both fitters and compare.
+    void Fit(bpkRunHitFit& reference, bpkRunHitFit& test,
+	     const bpkHitFitInput& input, bool useObjRes = false);
+
+    // Compare the results of the last event fitted by reference and test.
+    void Compare(const bpkRunHitFit& reference, const bpkRunHitFit& test);
+
+    void Merge(const bpkHitFitPrecisionReport& other);
+
+    void Reset();
+
+    // Events compared, and those whose permutation lists differ
+    // (e.g. pre-ranking picked other ones) and were not compared
+    // permutation by permutation.
+    unsigned long NumEvents() const;
+    unsigned long NumLayoutMismatch() const;
+
+    // Permutations compared, and those converged in only one fitter.
+    unsigned long NumPermutations() const;
+    unsigned long NumStatusMismatch() const;
+
+    // Events with a best permutation in both, and those where it is the same.
+    unsigned long NumBestCompared() const;
+    unsigned long NumBestAgree() const;
+    double BestAgreement() const;
+
+    // test - reference over the permutations converged in both.
+    const bpkHitFitHistogram& Chi2Diff() const;
+    const bpkHitFitHistogram& MtDiff() const;
+    // The same relative to the reference value.
+    const bpkHitFitHistogram& Chi2RelDiff() const;
+    const bpkHitFitHistogram& MtRelDiff() const;
+
+    std::ostream& dump(std::ostream& s) const;
+
+  private:
+
+    unsigned long      _nevents;
+    unsigned long      _nlayout;
+    unsigned long      _nperm;
+    unsigned long      _nstatus;
+    unsigned long      _nbest;
+    unsigned long      _nbestAgree;
+    bpkHitFitHistogram _chi2Diff;
+    bpkHitFitHistogram _mtDiff;
+    bpkHitFitHistogram _chi2RelDiff;
+    bpkHitFitHistogram _mtRelDiff;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITPRECISION
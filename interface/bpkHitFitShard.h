@@ -0,0 +1,123 @@
+#ifndef BPKHITFITSHARD
+#define BPKHITFITSHARD
+
+#include <string>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPipeline.h"
+
+#include "Rtypes.h"
+
+class TDirectory;
+class TTree;
+
+namespace hitfit{
+
+  // Deterministic split of the input over independent worker processes.
+  //
+  // Each of nshards processes reads the same input through a
+  // bpkHitFitShardSource with its own shard number, fits the events it
+  // is handed and writes them with bpkHitFitWriter, with the entry
+  // column, into its own file.  No coordination is needed between the
+  // processes; bpkHitFitShardMerger then combines the shard files.
+  //
+  //   by_range - shard s takes the entries [s*n/nshards, (s+1)*n/nshards)
+  //              of the n = nevents entries of the input, and stops
+  //              reading after its range
+  //   by_hash  - shard s takes the events whose run and event number
+  //              hash to s; every shard reads the whole input, but an
+  //              uneven input (e.g. sorted by jet multiplicity) is
+  //              spread evenly
+  //
+  // The events handed on keep their entry in the whole input.
+  class bpkHitFitShardSource : public bpkHitFitSource {
+
+  public:
+
+    enum Mode { by_range, by_hash };
+
+    bpkHitFitShardSource(bpkHitFitSource& source,
+			 int              nshards,
+			 int              shard,
+			 Mode             mode = by_hash,
+			 long             nevents = -1);
+
+    bool Next(bpkHitFitInput& input);
+
+    // Events read from the source, and handed on.
+    long NumRead() const;
+    long NumAccepted() const;
+
+    // Shard of the event at entry, for by_range of nevents entries.
+    static int ShardOf(long entry, int runnum, int evnum,
+		       int nshards, Mode mode, long nevents = -1);
+
+  private:
+
+    bpkHitFitSource& _source;
+    int              _nshards;
+    int              _shard;
+    Mode             _mode;
+    long             _nevents;
+    long             _nread;
+    long             _naccepted;
+
+  };
+
+  // Merge of the shard files of bpkHitFitShardSource workers.
+  //
+  // The result trees are merged in the order of their entry column, so
+  // the merged tree has the entries of a single-process run of the whole
+  // input, in the same order; without an entry column the shards are
+  // concatenated in the order they were added, which is the input order
+  // for by_range shards.  The files themselves are not byte-identical to
+  // a single-process output, ROOT writes its own identifiers and
+  // timestamps into every file, but every branch holds the same values.
+  //
+  // The instrumentation each worker stored with WriteShardInfo() is
+  // copied into one tree with an entry per shard, and summed in
+  // Counters().
+  class bpkHitFitShardMerger {
+
+  public:
+
+    bpkHitFitShardMerger(const std::string& tree_name = "hitfit",
+			 const std::string& prefix = "");
+
+    void Add(const std::string& file);
+
+    // Write the merged result tree and the shard info tree into dir;
+    // false if a shard file or its result tree cannot be read.
+    bool Merge(TDirectory* dir);
+
+    Long64_t NumEntries() const;
+
+    const bpkRunHitFitCounters& Counters() const;
+
+    // Store the instrumentation of a worker in its shard file;
+    // stats may be 0 when the fit was not run through bpkHitFitPipeline.
+    static void WriteShardInfo(TDirectory*                   dir,
+			       int                           shard,
+			       int                           nshards,
+			       const bpkRunHitFitCounters&   counters,
+			       const bpkHitFitPipelineStats* stats = 0);
+
+    static const char* const SHARD_INFO_TREE;
+
+  private:
+
+    bool MergeResults(const std::vector<TTree*>& trees, TDirectory* dir);
+
+    void MergeShardInfo(const std::vector<TTree*>& trees, TDirectory* dir);
+
+    std::string               _tree_name;
+    std::string               _prefix;
+    std::vector<std::string>  _files;
+    Long64_t                  _nentries;
+    bpkRunHitFitCounters      _counters;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITSHARD
@@ -0,0 +1,102 @@
+#ifndef BPKHITFITTOYS
+#define BPKHITFITTOYS
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/TopGluon_Fit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Scratch_Vector.h"
+
+#include "TopQuarkAnalysis/TopHitFit/interface/Fit_Result.h"
+
+namespace hitfit{
+
+  struct bpkHitFitToyStats {
+    bpkHitFitToyStats();
+
+    unsigned long ntoys;
+    double        smear_seconds;  // summed over the worker threads
+    double        fit_seconds;    // summed over the worker threads
+    double        wall_seconds;
+  };
+
+  // Pseudo-experiments for pull and bias studies.
+  //
+  // Run() makes ntoys replicas of an event, smears each one with
+  // Lepjets_Event::smear() according to the resolutions of its objects,
+  // and refits it with the jet assignment the event carries.
+  //
+  // Toy i draws its random numbers from the Counter_Random_Engine stream
+  // (key, i), so its result only depends on the event, the key and i:
+  // the results are the same for any number of threads and any order
+  // in which the toys are picked up.
+  //
+  // The toys are handed to the worker threads in batches of batch_size.
+  // A worker first smears all replicas of a batch, then fits them; the
+  // replicas and results of each batch are kept between runs and
+  // recycled.
+  class bpkHitFitToys {
+
+  public:
+
+    bpkHitFitToys(const TopGluon_Fit& fitter,
+		  int                 nthreads = 1,
+		  size_t              batch_size = 64,
+		  bool                smear_dir = false);
+
+    // Generate and fit ntoys replicas of ev, using neutrino solution nuz.
+    // ev needs its jet types set, e.g. the event of a Fit_Result or
+    // bpkRunHitFit::GetUnfittedEvent(i).
+    void Run(const Lepjets_Event& ev, bool nuz, unsigned long ntoys, uint64_t key);
+
+    unsigned long NumToys() const;
+
+    // Smeared replica i, before the fit.
+    const Lepjets_Event& GetToyEvent(unsigned long i) const;
+
+    const Fit_Result& GetToyResult(unsigned long i) const;
+
+    const bpkHitFitToyStats& Stats() const;
+
+    // Stream key for an event.
+    static uint64_t EventKey(int runnum, int evnum, uint32_t seed = 0);
+
+  private:
+
+    struct Batch {
+      Scratch_Vector<Lepjets_Event> events;
+      Scratch_Vector<Fit_Result>    results;
+    };
+
+    void Worker(int worker);
+
+    void RunBatch(int worker, unsigned long b);
+
+    bpkHitFitToys(const bpkHitFitToys&);
+    bpkHitFitToys& operator=(const bpkHitFitToys&);
+
+    std::vector<TopGluon_Fit>   _fitters;
+    size_t                      _batch_size;
+    bool                        _smear_dir;
+
+    // Input of the current run.
+    const Lepjets_Event*        _ev;
+    bool                        _nuz;
+    unsigned long               _ntoys;
+    uint64_t                    _key;
+
+    std::vector<Batch>          _batches;
+    unsigned long               _nbatches;
+    std::atomic<unsigned long>  _next_batch;
+
+    std::vector<double>         _smear_seconds;
+    std::vector<double>         _fit_seconds;
+    bpkHitFitToyStats           _stats;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITTOYS
@@ -0,0 +1,144 @@
+#ifndef BPKHITFITWRITER
+#define BPKHITFITWRITER
+
+#include <string>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPipeline.h"
+
+#include "Rtypes.h"
+
+class TTree;
+
+namespace hitfit{
+
+  // Write the results of bpkRunHitFit::FitAllPermutation() into a TTree,
+  // one entry per event and one array element per fitted permutation.
+  //
+  // Every selected quantity is its own branch, so the output is stored
+  // column by column and ROOT compresses it basket by basket; the basket
+  // size (TTree::SetAutoFlush) sets the batch in which results are
+  // flushed to the file.
+  //
+  // The columns are selected by a comma or space separated list of names:
+  //   chi2    - fit chi-square
+  //   mt      - fitted top mass
+  //   sigmt   - uncertainty on the fitted top mass
+  //   umwhad  - hadronic W mass before the fit
+  //   utmass  - top mass before the fit
+  //   perm    - permutation code, see bpkRunHitFit::PermutationCode()
+  //   p4      - fitted four-vectors of the lepton, the neutrino and the
+  //             lepb, hadb, hadw1, hadw2, gluon1 and gluon2 jets; the
+  //             W jets by position, hadw1 the first
+  //   tgmass  - fitted t+g masses of the leptonic and hadronic side
+  //   pull    - pull quantities, pullx and pully
+  //   all     - all of the above (the default)
+  //   entry   - position of the event in the whole input, used by
+  //             bpkHitFitShardMerger to restore the input order;
+  //             not part of all
+  // The run and event number, the number of jets and the number of
+  // permutations are always written.  Every permutation is written, the
+  // arrays grow with the largest event.
+  //
+  // Four-vectors and pulls can optionally be stored with a reduced number
+  // of mantissa bits.  The values are still written as floats, but the
+  // zeroed low bits make them compress much better.
+  class bpkHitFitWriter {
+
+  public:
+
+    enum Column {
+      chi2_column   = 1 << 0,
+      mt_column     = 1 << 1,
+      sigmt_column  = 1 << 2,
+      umwhad_column = 1 << 3,
+      utmass_column = 1 << 4,
+      perm_column   = 1 << 5,
+      p4_column     = 1 << 6,
+      tgmass_column = 1 << 7,
+      pull_column   = 1 << 8,
+      all_columns   = (1 << 9) - 1,
+      entry_column  = 1 << 9
+    };
+
+    // Book the branches of the selected columns on tree, with
+    // prefix prepended to every branch name.
+    bpkHitFitWriter(TTree*             tree,
+		    const std::string& columns = "all",
+		    const std::string& prefix  = "");
+
+    ~bpkHitFitWriter();
+
+    // Number of mantissa bits kept for four-vectors and pulls;
+    // 23 or more (the default) keeps full float precision.
+    void SetP4Precision(int nbits);
+
+    void SetPullPrecision(int nbits);
+
+    // Fill one tree entry with the results currently held by fitter;
+    // entry is only written with entry_column.
+    void Fill(const bpkRunHitFit& fitter, int runnum, int evnum, long entry = -1);
+
+    // Fill one tree entry with the results handed over by bpkHitFitPipeline.
+    void Fill(const bpkHitFitOutput& output);
+
+    unsigned int Columns() const;
+
+    static unsigned int ParseColumns(const std::string& columns);
+
+    static float ReduceMantissa(float x, int nbits);
+
+  private:
+
+    void Begin(int runnum, int evnum, long entry, int njets, int nperm);
+
+    // Make the arrays hold nperm permutations; book the branches on
+    // them with book, otherwise rebind them if they moved.
+    void Reserve(int nperm, bool book = false);
+
+    // From a Fit_Result or a Compact_Fit_Result.
+    template <class Result>
+    void FillPermutation(int i, const Result& result, int code);
+
+    // Number of four-vectors stored per permutation.
+    static const int N_P4 = 8;
+
+    TTree*              _tree;
+    unsigned int        _columns;
+    int                 _p4_bits;
+    int                 _pull_bits;
+
+    int                 _runnum;
+    int                 _evnum;
+    Long64_t            _entry;
+    int                 _njets;
+    int                 _nperm;
+    int                 _npullx_tot;
+    int                 _npully_tot;
+
+    std::string         _prefix;
+    int                 _capacity;   // permutations the arrays hold
+
+    std::vector<float>  _chi2;
+    std::vector<float>  _mt;
+    std::vector<float>  _sigmt;
+    std::vector<float>  _umwhad;
+    std::vector<float>  _utmass;
+    std::vector<int>    _perm;
+    std::vector<float>  _px[N_P4];
+    std::vector<float>  _py[N_P4];
+    std::vector<float>  _pz[N_P4];
+    std::vector<float>  _e[N_P4];
+    std::vector<float>  _mtg_lep;
+    std::vector<float>  _mtg_had;
+    std::vector<int>    _npullx;
+    std::vector<int>    _npully;
+    std::vector<float>  _pullx;
+    std::vector<float>  _pully;
+
+  };
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITWRITER
@@ -7,7 +7,14 @@
 #include "MyAna/bpkHitFitForExcitedQuark/interface/HitFitTranslator.h"
 #include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event.h"
 #include "MyAna/bpkHitFitForExcitedQuark/interface/TopGluon_Fit.h"
-//#include "TopQuarkAnalysis/TopHitFit/interface/Top_Fit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Scratch_Vector.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Event.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Fit_Result.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Scalar_Kinematics.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitCache.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitBTag.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitAlloc.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPerf.h"
 
 #include "TopQuarkAnalysis/TopHitFit/interface/Fit_Result.h"
 
@@ -19,6 +26,60 @@ static const unsigned int MAX_HITFIT_VAR =  32 ;
 
 namespace hitfit{
 
+  // Bookkeeping of the permutation loop, summed over events until
+  // bpkRunHitFit::ResetCounters().
+  struct bpkRunHitFitCounters {
+    bpkRunHitFitCounters();
+
+    unsigned long events;
+    unsigned long permutations;     // permutations times neutrino solutions tried
+    unsigned long fits;             // constrained fits run, all hypotheses
+    unsigned long tg_mass_pruned;   // permutations rejected by the t+g mass window
+    unsigned long tg_fits_saved;    // constrained fits those would have needed
+    unsigned long prerank_skipped;  // permutations not fitted after the pre-ranking
+
+    // Pre-ranking validation: events with a converged fit, and the
+    // number of them by pre-rank of the best chi2 permutation.
+    unsigned long              prerank_validated;
+    std::vector<unsigned long> prerank_best_rank;
+
+    // Fraction of the validated events whose best chi2 permutation
+    // is among the first n of the pre-ranking.
+    double prerank_recall(size_t n) const;
+
+    // Add the counts of other, e.g. of another fitter or shard.
+    bpkRunHitFitCounters& operator+=(const bpkRunHitFitCounters& other);
+
+    // Two-stage fit: permutations refitted in full, and in validation
+    // mode the events with a converged full fit, those whose best full
+    // fit was among the refitted ones, and those where the two-stage
+    // result picks the same best permutation as the full fits.
+    unsigned long twostage_refined;
+    unsigned long twostage_validated;
+    unsigned long twostage_best_refined;
+    unsigned long twostage_best_agree;
+
+    // Two-stage fit: fitted permutations whose coarse fit did not
+    // converge, refitted in full, and converged ones left out for being
+    // outside the margin.
+    unsigned long twostage_unconverged;
+    unsigned long twostage_outside_margin;
+
+    // Second neutrino solutions equal to the first, not fitted again.
+    unsigned long nu_degenerate;
+
+    // ttbar fits run next to the t+g ones, see SetTTbarFit().
+    unsigned long ttbar_fits;
+
+    // Lazy pulls: fits run again for the pulls of the best results,
+    // see SetLazyPulls(); also counted in fits.
+    unsigned long lazy_refits;
+
+    // Result cache: events taken from it, events fitted and stored.
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+  };
+
   class bpkRunHitFit {
 
   private:
@@ -34,14 +95,322 @@ namespace hitfit{
     bool                                _jetObjRes;
 
     TopGluon_Fit                             _TopGluon_Fit;
-    //Top_Fit                             _Top_Fit;
 
-    std::vector<Lepjets_Event>          _Unfitted_Events;
+    // Unfitted events in compact form, referring to _compactSource.
+    Scratch_Vector<Compact_Event>       _Unfitted_Events;
+
+    // Fit results in compact form: the fitted momenta refer to the
+    // objects, and so the resolutions, of _compactSource.
+    Scratch_Vector<Compact_Fit_Result>  _Fit_Results;
+
+    // Permutation code of each entry in _Fit_Results,
+    // see PermutationCode().
+    Scratch_Vector<int>                 _Fit_Codes;
 
-    std::vector<Fit_Result>             _Fit_Results;
+    // Index into _candidates of each entry in _Fit_Results.
+    Scratch_Vector<int>                 _Fit_Candidates;
+
+    // Set for an entry in _Fit_Results copied from the one before,
+    // its neutrino solution being the same.
+    Scratch_Vector<char>                _Fit_Degenerate;
 
     int                  _nu_solution;
 
+    // Per-event scratch, recycled between events so that the
+    // permutation loop does not allocate once warmed up.
+    // Each jet is translated once as a b jet and once as a light jet;
+    // the permutation loop only picks one of the two.
+    std::vector<Lepjets_Event_Jet>      _bJets;
+    std::vector<Lepjets_Event_Jet>      _lightJets;
+    std::vector<bpkHitFitJet>           _jetInputs;
+    Scratch_Vector< std::vector<int> >  _candidates;
+    std::vector<int>                    _jet_types;
+
+    // b-tag selection of the permutations, see SetBTagPolicy(), and
+    // its mask for the current event.
+    bpkHitFitBTagPolicy                 _btagPolicy;
+    bpkHitFitBTagMask                   _btagMask;
+
+    // The permutations of the t+g slots over n jets, built once for
+    // each n: the jet types, and the masks of the jets in the b slots
+    // and in the gluon slots for the b-tag selection.
+    struct PermutationTable {
+      std::vector< std::vector<int> >   jet_types;
+      std::vector<unsigned>             bslots;
+      std::vector<unsigned>             gslots;
+    };
+    std::vector<PermutationTable>       _permTables;
+    Lepjets_Event                       _fev;
+    // The event of the permutation being fitted, see BuildEvent(), the
+    // source jet of each of its jets, and whether it is valid for the
+    // source of the current loop.
+    Lepjets_Event                       _builtEv;
+    std::vector<int>                    _builtSrc;
+    bool                                _builtValid;
+    Compact_Event                       _builtCompact;
+    Lepjets_Event                       _compactSource;
+    mutable Lepjets_Event               _unfittedEv;
+    mutable Lepjets_Event               _resultEv;
+    mutable Fit_Result                  _result;
+    Column_Vector                       _pullx;
+    Column_Vector                       _pully;
+
+    std::string                         _default_file;
+    double                              _lepw_mass;
+    double                              _hadw_mass;
+    double                              _top_mass;
+
+    // Top mass scan: one fitter and one result list per extra
+    // top mass hypothesis, see SetTopMassScan().
+    std::vector<double>                 _scanMasses;
+    std::vector<TopGluon_Fit>           _scanFits;
+    std::vector< Scratch_Vector<Compact_Fit_Result> > _scanResults;
+    Lepjets_Event                       _scanEv;
+
+    // Events after TopGluon_Fit::prepare_one_perm(), and whether they
+    // passed it, for each entry in _Fit_Results; kept for the mass scan,
+    // the two-stage fit and the lazy pulls only, see KeepPrepared().
+    Scratch_Vector<Compact_Event>       _preparedEvents;
+    Scratch_Vector<char>                _prepared;
+
+    // Two-stage fit, see SetTwoStageFit().
+    int                                 _twoStageMaxit;
+    double                              _twoStageEps;
+    std::vector<TopGluon_Fit>           _coarseFit;
+    double                              _twoStageMargin;
+    bool                                _twoStageValidate;
+    std::vector<char>                   _refined;
+    Scratch_Vector<Compact_Fit_Result>  _fullResults;
+    Compact_Fit_Result                  _fullResult;
+
+    // Jet energy scale variations, see SetJESVariations().
+    std::vector<JetTranslator>          _jesTranslators;
+    // Each variation has its own source event for the compact results.
+    std::vector<Lepjets_Event>          _jesSources;
+    std::vector< Scratch_Vector<Compact_Fit_Result> > _jesResults;
+
+    // t+g mass window, see SetTopGluonMassWindow()
+    double                              _tgMassMin;
+    double                              _tgMassMax;
+    double                              _tgEqualSideTolerance;
+    // Unfitted four-vector sums the pre-ranking scores are taken from:
+    //   _bLightPairs[j*n+k]        b jet j + light jet k
+    //   _hadTriplets[(j*n+k)*n+l]  b jet j + light jets k and l, k < l
+    std::vector<Fourvec>                _bLightPairs;
+    std::vector<Fourvec>                _hadTriplets;
+
+    // Pre-ranking, see SetPreRank().
+    int                                 _preRankTopN;
+    double                              _preRankDelta;
+    bool                                _preRankValidate;
+    Fourvec                             _lepnu[2];
+    std::vector<double>                 _candidateScores;
+    std::vector<int>                    _candidateOrder;
+    std::vector<int>                    _candidateRank;
+    std::vector<char>                   _candidateSelected;
+
+    // ttbar fit, see SetTTbarFit(); its permutations are those of the
+    // permutation table passing the b-slot requirement, with the jets
+    // outside the ttbar slots taken as ISR, each once, _ttbarSeen
+    // holding their codes in order.
+    std::vector<TTbar_Fit>              _ttbarFit;
+    Scratch_Vector< std::vector<int> >  _ttbarCandidates;
+    std::vector<int>                    _ttbarSeen;
+    Scratch_Vector<Compact_Fit_Result>  _ttbarResults;
+    Scratch_Vector<int>                 _ttbarCodes;
+
+    // Neutrino pz solutions of the event; without solve_nu_tmass they
+    // do not depend on the jets and are shared by all permutations.
+    bool                                _nuzValid;
+    double                              _eventNuz[2];
+
+    // Single-precision setup of the permutations, see
+    // SetSinglePrecision(); _scalarSource holds the objects of the
+    // source event the permutations are built from.
+    bool                                _singlePrecision;
+    Scalar_Event<float>                 _scalarSource;
+    Scalar_Perm_Kinematics<float>       _scalarKin;
+
+    // Lazy pulls, see SetLazyPulls(): the indices of the results
+    // refitted for their pulls, at most _lazyPulls of them; _noPulls
+    // stays empty.
+    int                                 _lazyPulls;
+    std::vector<int>                    _pullHolders;
+    Column_Vector                       _noPulls;
+
+    // Deterministic mode, see SetDeterministic().
+    bool                                _deterministic;
+
+    // Stage accounting, see SetPerfCounters().
+    bool                                _usePerf;
+    bpkHitFitPerf                       _perf;
+
+    // Allocation audit, see SetAllocAudit(): the most jets and results
+    // of an event so far, and the loop allocations of the last event.
+    bool                                _allocAudit;
+    size_t                              _allocWarmJets;
+    size_t                              _allocWarmResults;
+    bpkHitFitAllocCount                 _loopAlloc;
+    bpkHitFitAllocAudit                 _alloc;
+
+    // Result cache, see SetCache().
+    bpkHitFitCache*                     _cache;
+    uint64_t                            _cacheExtraHash;
+    uint64_t                            _defaultFileHash;
+    std::vector<char>                   _cachePayload;
+
+    bpkRunHitFitCounters                _counters;
+
+    // Fit the permutations of the jets in _jetInputs, with the
+    // allocation audit around FitJetPermutations() when on.
+    std::vector<Fit_Result>::size_type FitPermutations();
+    std::vector<Fit_Result>::size_type FitJetPermutations();
+
+    // Allocations of this thread, less those of the constrainer calls.
+    bpkHitFitAllocCount LoopAllocCount() const;
+
+    // Empty the result lists of the last event.
+    void ResetResults();
+
+    bool UseCache() const;
+
+    // Serialize the nominal results into payload, or fill them from it;
+    // LoadResults() needs _compactSource and fails on a payload that
+    // does not match the event.
+    void StoreResults(std::vector<char>& payload) const;
+    bool LoadResults(const std::vector<char>& payload);
+
+    // Fill _bJets/_lightJets from _jetInputs.
+    void TranslateJets(JetTranslator& translator);
+
+    // Point the fitters at _perf, or at nothing; copies of a fitter
+    // point at nothing until then.
+    void AttachPerf();
+
+    // Fill _candidates with the jet permutations passing the b-tag
+    // requirement.
+    void FindPermutations();
+
+    const PermutationTable& GetPermutationTable(size_t njets);
+
+    // Fill source with _event and both translations of the jets.
+    void BuildCompactSource(Lepjets_Event& source) const;
+
+    // Fill c with the leptons of source and the translated jets,
+    // labelled by jet_types.
+    void BuildCompact(const std::vector<int>& jet_types,
+		      const Lepjets_Event& source,
+		      Compact_Event& c) const;
+
+    // Build the event of the permutation jet_types of the objects of
+    // source, as filled by BuildCompactSource(), in _builtEv, reusing
+    // what it holds of the last permutation of the same source.
+    void BuildEvent(const std::vector<int>& jet_types,
+		    const Lepjets_Event& source);
+
+    // Fit candidate p with fitter into the nominal results, for
+    // each neutrino solution.
+    void FitPermutation(int p, TopGluon_Fit& fitter);
+
+    // Sum the objects of the permutation in _builtCompact/_builtEv and
+    // solve for its two neutrino pz with fitter, in the precision
+    // selected.
+    template <class Fit>
+    void SolvePermutation(Fit& fitter, double& umwhad, double& umthad, double nuz[2]);
+
+    // Set the neutrino pz of fev, built by SolvePermutation() with the
+    // same fitter, to nuz and apply the mass cuts of fitter; false if
+    // they fail.
+    template <class Fit>
+    bool PrepareSolution(Fit& fitter, Lepjets_Event& fev, double nuz, double umwhad,
+			 double umthad, double& utmass);
+
+    // Make entry i of v, appended if i is its size, a copy of entry
+    // i-1: the result of a second neutrino solution equal to the
+    // first, which would give the same fit.
+    template <class Vector>
+    static void CopyDegenerate(Vector& v, size_t i);
+
+    // Fit the event in _builtEv with neutrino pz nuz.
+    void FitSolution(const std::vector<int>& jet_types, double nuz,
+		     double umwhad, double umthad, TopGluon_Fit& fitter);
+
+    // Fit result i at the mass scan points.
+    void FitScan(std::vector<Fit_Result>::size_type i);
+
+    bool UseTwoStage() const;
+
+    // Full fit of the prepared event of result i.
+    void FullFit(std::vector<Fit_Result>::size_type i, Compact_Fit_Result& full);
+
+    // Second stage of the two-stage fit.
+    void RefineFits();
+
+    bool UseLazyPulls() const;
+
+    // Whether _preparedEvents/_prepared are filled.
+    bool KeepPrepared() const;
+
+    // Refit the _lazyPulls best converged nominal results from their
+    // prepared events, for their pulls.
+    void RefitPulls();
+
+    // Whether result a ranks before result b of results, whose
+    // permutation codes are codes: lower chisq, then in deterministic
+    // mode lower code, then lower index.
+    bool RanksBefore(const Scratch_Vector<Compact_Fit_Result>& results,
+		     const Scratch_Vector<int>& codes, int a, int b) const;
+
+    // Index of the first converged result of results by RanksBefore(), or -1.
+    int BestFit(const Scratch_Vector<Compact_Fit_Result>& results,
+		const Scratch_Vector<int>& codes) const;
+
+    // Fit one permutation of the jets of source with fitter into
+    // results, with the nominal masses only, and its permutation
+    // codes into codes if given.
+    template <class Fit>
+    void FitVariation(const std::vector<int>& jet_types,
+		      const Lepjets_Event& source,
+		      Fit& fitter,
+		      Scratch_Vector<Compact_Fit_Result>& results,
+		      Scratch_Vector<int>* codes = 0);
+
+    bool UseTTbarFit() const;
+
+    // Fill _ttbarCandidates from the permutation table and _btagMask.
+    void FindTTbarPermutations();
+
+    // Rebuild result r, of a fit from source, into _result.
+    const Fit_Result& MakeResult(const Compact_Fit_Result& r,
+				 const Lepjets_Event& source) const;
+
+    bool UseTopGluonMassWindow() const;
+
+    bool UsePreRank() const;
+
+    // Scores and ranks are needed, to select or only to validate.
+    bool UsePreRankScores() const;
+
+    // Score, rank and select the _candidates for the fit.
+    void SelectCandidates();
+
+    // Pre-ranking score of one jet permutation, lower is better.
+    double PreRankScore(const std::vector<int>& jet_types) const;
+
+    // Fill _bLightPairs/_hadTriplets from _bJets/_lightJets.
+    void BuildMassTables();
+
+    // Unfitted decay masses of fev after PrepareSolution() with fitter:
+    // kept by fitter in double precision, summed from fev otherwise.
+    template <class Fit>
+    Decay_Masses PreparedMasses(const Fit& fitter, const Lepjets_Event& fev) const;
+
+    // Check the unfitted t+g masses m of a permutation, as given by
+    // PreparedMasses(), against the window.  Permutations
+    // without both gluon slots always pass.
+    bool PassTopGluonMassWindow(const std::vector<int>& jet_types,
+				const Decay_Masses& m) const;
+
   public:
 
     bpkRunHitFit(const LeptonTranslator& lep,
@@ -69,14 +438,252 @@ namespace hitfit{
     void SetMETResolution(const Resolution& res);
 
     const TopGluon_Fit& GetTopGluonFit() const;
-    //const Top_Fit& GetTopFit() const;
 
-    std::vector<Fit_Result>::size_type FitAllPermutation(const JetInfoBranches& jet, std::vector<bool> jetisbtag);
+    // jetisbtag is indexed by the jet branch index; whether it or the
+    // CombinedSVBJetTags discriminant is used is up to the b-tag policy.
+    std::vector<Fit_Result>::size_type FitAllPermutation(const JetInfoBranches& jet, const std::vector<bool>& jetisbtag);
+
+    // Fill the event from input and fit all permutations,
+    // equivalent to clear(), AddLepton(), AddJet(), SetMet() and
+    // FitAllPermutation() with the bprimeKit branches.
+    std::vector<Fit_Result>::size_type FitEvent(const bpkHitFitInput& input, bool useObjRes = false);
+
+    // Top mass scan.  Every permutation is in addition fitted with the
+    // top mass constrained to each of top_masses.  The translation, the
+    // b-tag selection of the permutations, the neutrino solution and the
+    // mass cuts are done once per permutation and shared by all mass
+    // points.  Result i of mass point k belongs to the same permutation
+    // as GetFitResult(i).  An empty list switches the scan off.
+    void SetTopMassScan(const std::vector<double>& top_masses);
+
+    std::vector<double>::size_type NumScanPoints() const;
+
+    double GetScanMass(std::vector<double>::size_type k) const;
+
+    // The results are kept in compact form and rebuilt on access, as
+    // for GetFitResult().
+    const Fit_Result& GetScanResult(std::vector<double>::size_type k,
+				    std::vector<Fit_Result>::size_type i) const;
+
+    std::vector<Fit_Result> GetScanFitAllPermutation(std::vector<double>::size_type k);
+
+    // Jet energy scale variations.  Every event is in addition fitted
+    // once for each (jes, jesB) pair, replacing the scale factors the
+    // JetTranslator was built with.  The input, the b-tag selection of
+    // the permutations and the lepton and MET translation are shared
+    // with the nominal fit.  Result i of variation v belongs to the same
+    // permutation as GetFitResult(i).  An empty list switches them off.
+    void SetJESVariations(const std::vector< std::pair<double,double> >& variations);
+
+    std::vector<JetTranslator>::size_type NumJESVariations() const;
+
+    // Rebuilt on access, as for GetFitResult().
+    const Fit_Result& GetJESResult(std::vector<JetTranslator>::size_type v,
+				   std::vector<Fit_Result>::size_type i) const;
+
+    std::vector<Fit_Result> GetJESFitAllPermutation(std::vector<JetTranslator>::size_type v);
+
+    // Window on the unfitted t+g masses, lepton + neutrino + lepb +
+    // gluon1 and hadb + hadw1 + hadw2 + gluon2, applied before the
+    // constrained fit.  Both masses must lie within [mass_min, mass_max];
+    // with equal_side_tolerance > 0 they must in addition agree within
+    // that many GeV, as the equal_side constraint of Constrained_TopGluon
+    // will require of the fitted masses.  A rejected permutation is kept
+    // in the results with chisq -999, as for the mass cuts of
+    // TopGluon_Fit.  mass_max <= 0 switches the window off (the default).
+    void SetTopGluonMassWindow(double mass_min, double mass_max,
+			       double equal_side_tolerance = 0.);
+
+    // Pre-ranking of the jet permutations.  Before any fit, every
+    // permutation passing the b-tag requirement gets a score from its
+    // unfitted masses (hadronic W, and the difference of the two top
+    // masses), the b-tag agreement of its jet assignment and the pT
+    // ordering of the jets outside the hypothesis slots.  Only the top_n best scored permutations
+    // are fitted (top_n <= 0: no limit), and with delta > 0 only those
+    // scoring within delta of the best one.  Both neutrino solutions of
+    // a selected permutation are fitted.
+    //
+    // With validate set every permutation is still fitted, and the
+    // pre-rank of the best chi2 permutation is recorded in Counters(),
+    // to pick top_n and delta with a known loss; this also works with
+    // no limit, SetPreRank(0, 0, true).
+    void SetPreRank(int top_n, double delta = 0., bool validate = false);
+
+    // Two-stage fit.  Every permutation is first fitted with a coarse
+    // fitter, the full one with its iteration limit set to maxit and
+    // its convergence tolerances (chisq_diff_eps, constraint_sum_eps)
+    // set to eps.  Only the permutations within chi2_margin of the best
+    // coarse chisq, and those whose coarse fit did not converge (e.g.
+    // stopped at maxit), are then refitted in full, from the same
+    // starting point; the others keep their coarse result and are not
+    // fitted at the mass scan points.  The JES variations are fitted in full.
+    //
+    // With validate set every permutation is also fitted in full, and
+    // Counters() records how often the two-stage result agrees with the
+    // full fits on the best permutation.  maxit <= 0 switches the
+    // two-stage fit off (the default).
+    void SetTwoStageFit(int maxit, double eps, double chi2_margin, bool validate = false);
+
+    // ttbar fit next to the t+g fit.  With on set, every event is also
+    // fitted under the ttbar hypothesis (TTbar_Fit, with the same
+    // default file and masses), for the comparison of the two
+    // interpretations.  The ttbar permutations are the t+g ones with
+    // the gluon jets taken as ISR, each fitted once; the translation,
+    // the b-tag requirement on the b slots and the neutrino solutions
+    // are those of the t+g fit, a gluon veto does not apply.  Pre-ranking, the two-stage fit, the mass scan and the
+    // JES variations apply to the t+g fit only, and the cache is not
+    // used.  Events with fewer jets than the six t+g slots have no
+    // permutations under either hypothesis.
+    void SetTTbarFit(bool on);
+
+    // The ttbar results of the last event, as GetFitResult() etc.
+    std::vector<Fit_Result>::size_type NumTTbarResults() const;
+    const Fit_Result& GetTTbarResult(std::vector<Fit_Result>::size_type i) const;
+    const Compact_Fit_Result& GetTTbarCompactResult(std::vector<Fit_Result>::size_type i) const;
+    int GetTTbarPermutationCode(std::vector<Fit_Result>::size_type i) const;
+
+    // Index of the lowest converged chisq among the nominal (t+g) and
+    // the ttbar results of the last event, or -1; ties as set by
+    // SetDeterministic().
+    int GetBestFit() const;
+    int GetBestTTbarFit() const;
+
+    // b-tag policy.  A permutation is fitted only if the number of
+    // tagged jets in its b slots, and with the gluon veto none in its
+    // gluon slots, satisfy policy.  The policy is compiled into a jet
+    // bitmask once per event and every permutation is checked against
+    // the slot masks of a table built once per jet multiplicity.  The
+    // default is the original rule: the isBTag flags of the input, at
+    // least one tagged b slot, two if the event has two tagged jets.
+    void SetBTagPolicy(const bpkHitFitBTagPolicy& policy);
+
+    const bpkHitFitBTagPolicy& GetBTagPolicy() const;
+
+    // Lazy pulls.  The pulls of the permutations are mostly read for
+    // the best one or two.  With keep > 0 the nominal results store no
+    // pulls while the permutations are fitted; afterwards the keep
+    // results of lowest converged chisq are fitted again from their
+    // prepared events and given the pulls of that fit, the others keep
+    // empty pullx/pully.  With the two-stage fit only the refitted
+    // permutations are candidates.  chisq, mt and sigmt are kept for
+    // all, as are the pulls of the scan, JES and ttbar results.  The
+    // constrained fit still works out the pulls of every fit, so the
+    // saving is the pull storage and copies, for up to keep extra fits
+    // (counted in lazy_refits).  keep <= 0 switches it off (the
+    // default).
+    void SetLazyPulls(int keep);
+
+    // Deterministic mode, for validation runs that have to reproduce
+    // bit for bit.  The fit of an event does not depend on the thread
+    // or fitter copy it runs on, and the permutations are always
+    // enumerated in the same order, from the table of their jet
+    // multiplicity, pre-ranking only dropping some; the rankings then
+    // only depend on how ties are broken.  Off, equal chisq go to the
+    // earlier result; on, to the lower permutation code, so that the
+    // best permutation does not depend on the layout of the results
+    // either.  This covers GetBestFit(), GetBestTTbarFit(), the
+    // two-stage and pre-ranking bookkeeping and the lazy pulls.
+    // bpkHitFitPipeline has its own setting for its reductions.
+    void SetDeterministic(bool on);
+
+    bool IsDeterministic() const;
+
+    // Benchmark mode.  The time spent in the stages of the fit (jet
+    // translation, neutrino solve and mass cuts, import/export of the
+    // constrainer event and the constrainer itself) is summed in Perf(),
+    // with the hardware counters of bpkHitFitPerfCounters where they
+    // are available, and the time only where not.  The counters are
+    // opened on the thread fitting the first event after this, and
+    // count that thread; each fitter copy of bpkHitFitPipeline or
+    // bpkHitFitBatch opens its own.  Reading them costs a system call
+    // per stage, some microseconds per fit, which is in the numbers.
+    void SetPerfCounters(bool on);
+
+    const bpkHitFitPerf& Perf() const;
+
+    void ResetPerf();
+
+    // Allocation audit, for the memory use of large jet multiplicities.
+    // The heap allocations and bytes of every event are summed in
+    // AllocAudit() by number of jets, with those of the nominal
+    // permutation loop less the constrainer calls (the import/export of
+    // the Fourvec_Event and TopHitFit's matrices, allocated on every
+    // fit), and the growth of the process peak RSS
+    // while fitting them.  This turns on SetPerfCounters() as well,
+    // which splits the allocations by stage in Perf().  Allocations are
+    // only counted with the package built with BPKHITFIT_ALLOC_AUDIT
+    // (see bpkHitFitAlloc.h); otherwise only the RSS is reported.
+    void SetAllocAudit(bool on);
+
+    const bpkHitFitAllocAudit& AllocAudit() const;
+
+    void ResetAllocAudit();
+
+    // Single-precision mode.  The object sums, unfitted masses, neutrino
+    // solve and mass cuts of every permutation, done in double by
+    // TopGluon_Fit, are done from float copies of the translated
+    // momenta instead, with the sums and masses accumulated in double
+    // (see Scalar_Kinematics.h).  The constrained fit stays in double.
+    // Not available with the solve_nu_tmass option, which keeps the
+    // double path.  bpkHitFitPrecisionReport compares the results of
+    // the two modes.
+    void SetSinglePrecision(bool on);
+
+    bool UseSinglePrecision() const;
+
+    // Result cache.  Before fitting an event, its results are looked up
+    // in cache by run and event number, InputHash() and ConfigHash(); on
+    // a hit the fit is skipped and the results are those stored, and
+    // otherwise the new results are stored.  Only the nominal results
+    // are stored; the cache is not used while a mass scan or JES
+    // variations are set.  The cache is not owned, may be shared by
+    // several fitters, and 0 switches it off (the default).
+    //
+    // ConfigHash() covers the contents of the default file, the masses,
+    // the neutrino solution, the JES of the jet translator and the
+    // b-tag policy, pre-ranking (with its validation mode), t+g window,
+    // two-stage, precision and lazy pull settings; InputHash() the MET
+    // resolution of the event.  Anything else the results depend on,
+    // e.g. the resolution files, has to go into extra_hash.
+    void SetCache(bpkHitFitCache* cache, uint64_t extra_hash = 0);
+
+    uint64_t ConfigHash() const;
+
+    // Hash of the translated leptons, MET and MET resolution and of the
+    // jet inputs of the current event.
+    uint64_t InputHash() const;
+
+    const bpkRunHitFitCounters& Counters() const;
+
+    void ResetCounters();
 
     std::vector<Lepjets_Event> GetUnfittedEvent();
 
     std::vector<Fit_Result> GetFitAllPermutation();
 
+    // Access to the results of the last FitAllPermutation()
+    // without copying them.
+    std::vector<Fit_Result>::size_type NumFitResults() const;
+
+    // The results are kept in compact form and rebuilt on access;
+    // the reference is valid until the next call of GetFitResult(),
+    // GetScanResult(), GetJESResult() or GetTTbarResult().
+    const Fit_Result& GetFitResult(std::vector<Fit_Result>::size_type i) const;
+
+    // Result i as held, without rebuilding it; valid until the next fit.
+    const Compact_Fit_Result& GetCompactResult(std::vector<Fit_Result>::size_type i) const;
+
+    // The unfitted events are kept in compact form and rebuilt on
+    // access; the reference is valid until the next call.
+    const Lepjets_Event& GetUnfittedEvent(std::vector<Fit_Result>::size_type i) const;
+
+    int GetPermutationCode(std::vector<Fit_Result>::size_type i) const;
+
+    // Code identifying a fitted permutation: the jet permutation
+    // code of jetPermutationCode() times two, plus the neutrino
+    // solution (0 or 1).
+    static int PermutationCode(const std::vector<int>& jet_types, int nusol);
+
   };
 
 } // namespace hitfit
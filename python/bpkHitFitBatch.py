@@ -0,0 +1,159 @@
+"""Batch fitting of columnar (NumPy) events through bpkHitFitBatch.
+
+The events are passed as flat arrays with offsets, as in awkward or
+uproot jagged arrays:
+
+    fitter = bpkHitFitBatch.Fitter(default_file, 80.4, 80.4, 172.5, nthreads=8)
+    res = fitter.fit(leptons, jets, met)
+
+leptons has the columns px, py, pz, e, eta, type and offsets; jets has
+px, py, pz, e, eta, pt, ptcorr_l7b, ptcorr_l7uds, ptcorr_l3, btag and
+offsets, and optionally the b-tag discriminant btag_discr; met has x, y
+and met.  Arrays that are already contiguous and
+of the right dtype are handed to the library without a copy.  The fit
+runs on native threads, and ctypes releases the GIL for the duration
+of the call.
+
+The result is a dict of arrays: offsets (nevents+1) into the per
+permutation columns code, chi2, mt, sigmt, umwhad and utmass, and best
+(nevents), the index of the lowest converged chi2 within each event or
+-1.
+"""
+
+import ctypes
+
+import numpy as np
+
+_LIBRARY = "libMyAnabpkHitFitForExcitedQuark.so"
+
+
+def _load(path=None):
+    lib = ctypes.CDLL(path or _LIBRARY)
+    vp = ctypes.c_void_p
+    lib.bpkHitFitBatch_Create.restype = vp
+    lib.bpkHitFitBatch_Create.argtypes = [
+        ctypes.c_char_p, ctypes.c_double, ctypes.c_double, ctypes.c_double,
+        ctypes.c_int, ctypes.c_int,
+        ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p,
+        ctypes.c_char_p]
+    lib.bpkHitFitBatch_Destroy.restype = None
+    lib.bpkHitFitBatch_Destroy.argtypes = [vp]
+    lib.bpkHitFitBatch_Fit.restype = ctypes.c_long
+    lib.bpkHitFitBatch_Fit.argtypes = [vp, ctypes.POINTER(_Input), ctypes.c_int]
+    lib.bpkHitFitBatch_Get.restype = None
+    lib.bpkHitFitBatch_Get.argtypes = [vp] + [vp] * 8
+    return lib
+
+
+class _Input(ctypes.Structure):
+    # Must match hitfit::bpkHitFitBatchInput.
+    _fields_ = [("nevents", ctypes.c_long),
+                ("runnum", ctypes.c_void_p),
+                ("evnum", ctypes.c_void_p),
+                ("lep_offsets", ctypes.c_void_p),
+                ("lep_px", ctypes.c_void_p),
+                ("lep_py", ctypes.c_void_p),
+                ("lep_pz", ctypes.c_void_p),
+                ("lep_e", ctypes.c_void_p),
+                ("lep_eta", ctypes.c_void_p),
+                ("lep_type", ctypes.c_void_p),
+                ("jet_offsets", ctypes.c_void_p),
+                ("jet_px", ctypes.c_void_p),
+                ("jet_py", ctypes.c_void_p),
+                ("jet_pz", ctypes.c_void_p),
+                ("jet_e", ctypes.c_void_p),
+                ("jet_eta", ctypes.c_void_p),
+                ("jet_pt", ctypes.c_void_p),
+                ("jet_ptcorr_l7b", ctypes.c_void_p),
+                ("jet_ptcorr_l7uds", ctypes.c_void_p),
+                ("jet_ptcorr_l3", ctypes.c_void_p),
+                ("jet_btag", ctypes.c_void_p),
+                ("jet_btag_discr", ctypes.c_void_p),
+                ("met_x", ctypes.c_void_p),
+                ("met_y", ctypes.c_void_p),
+                ("met", ctypes.c_void_p)]
+
+
+_LEP_COLUMNS = [("px", np.float32), ("py", np.float32), ("pz", np.float32),
+                ("e", np.float32), ("eta", np.float32), ("type", np.int32)]
+_JET_COLUMNS = [("px", np.float32), ("py", np.float32), ("pz", np.float32),
+                ("e", np.float32), ("eta", np.float32), ("pt", np.float32),
+                ("ptcorr_l7b", np.float32), ("ptcorr_l7uds", np.float32),
+                ("ptcorr_l3", np.float32), ("btag", np.uint8)]
+_MET_COLUMNS = [("x", np.float32), ("y", np.float32), ("met", np.float32)]
+
+
+def _column(arrays, name, dtype, size, keep):
+    a = np.ascontiguousarray(arrays[name], dtype=dtype)
+    if a.shape != (size,):
+        raise ValueError("column %s has shape %s, expected (%d,)" % (name, a.shape, size))
+    keep.append(a)
+    return a.ctypes.data
+
+
+def _offsets(arrays, nevents, keep):
+    a = np.ascontiguousarray(arrays["offsets"], dtype=np.int64)
+    if a.shape != (nevents + 1,) or a[0] != 0 or np.any(np.diff(a) < 0):
+        raise ValueError("bad offsets")
+    keep.append(a)
+    return a, a.ctypes.data
+
+
+class Fitter(object):
+
+    def __init__(self, default_file, lepw_mass, hadw_mass, top_mass,
+                 nu_solution=-1, nthreads=1,
+                 electron_resolution="", muon_resolution="",
+                 udsc_resolution="", b_resolution="", met_resolution="",
+                 library=None):
+        self._lib = _load(library)
+        enc = lambda s: (s or "").encode()
+        self._handle = self._lib.bpkHitFitBatch_Create(
+            enc(default_file), lepw_mass, hadw_mass, top_mass,
+            nu_solution, nthreads,
+            enc(electron_resolution), enc(muon_resolution),
+            enc(udsc_resolution), enc(b_resolution), enc(met_resolution))
+        if not self._handle:
+            raise RuntimeError("bpkHitFitBatch_Create failed")
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            self._lib.bpkHitFitBatch_Destroy(self._handle)
+            self._handle = None
+
+    def fit(self, leptons, jets, met, runnum=None, evnum=None, use_obj_res=False):
+        nevents = len(met["met"])
+        keep = []
+        inp = _Input()
+        inp.nevents = nevents
+
+        lep_off, inp.lep_offsets = _offsets(leptons, nevents, keep)
+        jet_off, inp.jet_offsets = _offsets(jets, nevents, keep)
+        for name, dtype in _LEP_COLUMNS:
+            setattr(inp, "lep_" + name, _column(leptons, name, dtype, lep_off[-1], keep))
+        for name, dtype in _JET_COLUMNS:
+            setattr(inp, "jet_" + name, _column(jets, name, dtype, jet_off[-1], keep))
+        if "btag_discr" in jets:
+            inp.jet_btag_discr = _column(jets, "btag_discr", np.float32, jet_off[-1], keep)
+        inp.met_x = _column(met, "x", np.float32, nevents, keep)
+        inp.met_y = _column(met, "y", np.float32, nevents, keep)
+        inp.met = _column(met, "met", np.float32, nevents, keep)
+        if runnum is not None:
+            inp.runnum = _column({"runnum": runnum}, "runnum", np.int32, nevents, keep)
+        if evnum is not None:
+            inp.evnum = _column({"evnum": evnum}, "evnum", np.int32, nevents, keep)
+
+        nresults = self._lib.bpkHitFitBatch_Fit(self._handle, ctypes.byref(inp), int(use_obj_res))
+        if nresults < 0:
+            raise RuntimeError("bpkHitFitBatch_Fit failed")
+
+        out = {"offsets": np.empty(nevents + 1, dtype=np.int64),
+               "best": np.empty(nevents, dtype=np.int32),
+               "code": np.empty(nresults, dtype=np.int32)}
+        for name in ("chi2", "mt", "sigmt", "umwhad", "utmass"):
+            out[name] = np.empty(nresults, dtype=np.float64)
+        self._lib.bpkHitFitBatch_Get(
+            self._handle,
+            *[out[k].ctypes.data for k in ("offsets", "best", "code", "chi2",
+                                           "mt", "sigmt", "umwhad", "utmass")])
+        return out
@@ -0,0 +1,233 @@
+//
+// File: src/Compact_Event.cc
+// Purpose: Structure-of-arrays form of a Lepjets_Event for the
+//          permutation loop.
+//
+
+
+/**
+    @file Compact_Event.cc
+
+    @brief Structure-of-arrays form of a Lepjets_Event.  See the
+    documentation of header file Compact_Event.h for details.
+
+ */
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Event.h"
+
+
+namespace hitfit {
+
+
+Compact_Event::Compact_Event ()
+  : _nleps (0)
+{
+}
+
+
+void Compact_Event::reset (const Lepjets_Event& source)
+//
+// Purpose: Start an empty compact event of SOURCE.
+//
+{
+  _nleps = 0;
+  _met = source.met();
+  px.clear();
+  py.clear();
+  pz.clear();
+  e.clear();
+  type.clear();
+  src.clear();
+  tags.clear();
+}
+
+
+void Compact_Event::assign (const Lepjets_Event& ev)
+//
+// Purpose: Take all objects of EV, which becomes the source.
+//
+{
+  reset (ev);
+  for (std::vector<Lepjets_Event_Lep>::size_type i=0; i < ev.nleps(); i++)
+    add_lep (ev, i);
+  for (std::vector<Lepjets_Event_Jet>::size_type j=0; j < ev.njets(); j++)
+    add_jet (ev, j, ev.jet(j).type());
+}
+
+
+void Compact_Event::push (const Lepjets_Event_Lep& obj, int t, int s,
+                          unsigned char tag)
+{
+  const Fourvec& v = obj.p();
+  px.push_back (v.x());
+  py.push_back (v.y());
+  pz.push_back (v.z());
+  e.push_back (v.e());
+  type.push_back (t);
+  src.push_back (s);
+  tags.push_back (tag);
+}
+
+
+void Compact_Event::add_lep (const Lepjets_Event& source,
+                             std::vector<Lepjets_Event_Lep>::size_type i)
+//
+// Purpose: Add lepton I of SOURCE.  Leptons have to be added
+//          before the jets.
+//
+{
+  const Lepjets_Event_Lep& lep = source.lep(i);
+  push (lep, lep.type(), i, 0);
+  ++_nleps;
+}
+
+
+void Compact_Event::add_jet (const Lepjets_Event& source,
+                             std::vector<Lepjets_Event_Jet>::size_type j,
+                             int t)
+//
+// Purpose: Add jet J of SOURCE with type code T.
+//
+{
+  const Lepjets_Event_Jet& jet = source.jet(j);
+  unsigned char tag = 0;
+  if (jet.svx_tag()) tag |= svx_tag_bit;
+  if (jet.slt_tag()) tag |= slt_tag_bit;
+  push (jet, t, j, tag);
+}
+
+
+bool Compact_Event::set_jet_types (const std::vector<int>& jet_types)
+{
+  if (njets() != jet_types.size()) {
+    return false;
+  }
+  bool saw_hadw1 = false;
+  for (std::vector<int>::size_type i=0; i < jet_types.size(); i++) {
+    int t = jet_types[i];
+    if (t == hadw1_label) {
+      if (saw_hadw1)
+        t = hadw2_label;
+      saw_hadw1 = true;
+    }
+    type[_nleps + i] = t;
+  }
+  return true;
+}
+
+
+void Compact_Event::set_momenta (const Lepjets_Event& ev)
+//
+// Purpose: Take the four-momenta and the missing Et of EV, whose
+//          leptons and jets correspond one to one to ours.
+//
+{
+  for (std::vector<double>::size_type i=0; i < nobjs(); i++)
+    set_p (i, i < _nleps ? ev.lep(i).p() : ev.jet(i - _nleps).p());
+  _met = ev.met();
+}
+
+
+void Compact_Event::set_p (std::vector<double>::size_type i, const Fourvec& v)
+{
+  px[i] = v.x();
+  py[i] = v.y();
+  pz[i] = v.z();
+  e[i] = v.e();
+}
+
+
+void Compact_Event::to_event (const Lepjets_Event& s, Lepjets_Event& ev) const
+//
+// Purpose: Rebuild the full event in EV.  The objects are copied from
+//          the source S, then take the momenta, types and tags held here.
+//
+{
+  ev.clear (s.runnum(), s.evnum());
+  ev.met() = _met;
+  ev.kt_res() = s.kt_res();
+  ev.zvertex() = s.zvertex();
+  ev.setMC (s.isMC());
+  ev.dlb() = s.dlb();
+  ev.dnn() = s.dnn();
+
+  for (std::vector<double>::size_type i=0; i < _nleps; i++) {
+    ev.add_lep (s.lep(src[i]));
+    Lepjets_Event_Lep& lep = ev.lep(i);
+    lep.p() = p(i);
+    lep.type() = type[i];
+  }
+  for (std::vector<double>::size_type i=_nleps; i < nobjs(); i++) {
+    ev.add_jet (s.jet(src[i]));
+    Lepjets_Event_Jet& jet = ev.jet(i - _nleps);
+    jet.p() = p(i);
+    jet.type() = type[i];
+    jet.svx_tag() = (tags[i] & svx_tag_bit) != 0;
+    jet.slt_tag() = (tags[i] & slt_tag_bit) != 0;
+  }
+}
+
+
+void Compact_Event::restore_momenta (Lepjets_Event& ev) const
+//
+// Purpose: Reset the momenta of EV, rebuilt from us, to ours.
+//
+{
+  for (std::vector<double>::size_type i=0; i < _nleps; i++)
+    ev.lep(i).p() = p(i);
+  for (std::vector<double>::size_type i=_nleps; i < nobjs(); i++)
+    ev.jet(i - _nleps).p() = p(i);
+  ev.met() = _met;
+}
+
+
+std::vector<double>::size_type Compact_Event::nobjs () const
+{
+  return px.size();
+}
+
+
+std::vector<double>::size_type Compact_Event::nleps () const
+{
+  return _nleps;
+}
+
+
+std::vector<double>::size_type Compact_Event::njets () const
+{
+  return px.size() - _nleps;
+}
+
+
+Fourvec Compact_Event::p (std::vector<double>::size_type i) const
+{
+  return Fourvec (px[i], py[i], pz[i], e[i]);
+}
+
+
+double Compact_Event::eta (std::vector<double>::size_type i) const
+{
+  return p(i).pseudoRapidity();
+}
+
+
+double Compact_Event::phi (std::vector<double>::size_type i) const
+{
+  return p(i).phi();
+}
+
+
+Fourvec& Compact_Event::met ()
+{
+  return _met;
+}
+
+
+const Fourvec& Compact_Event::met () const
+{
+  return _met;
+}
+
+
+
+} // namespace hitfit
@@ -0,0 +1,156 @@
+//
+// File: src/Compact_Fit_Result.cc
+// Purpose: Fit_Result held as a Compact_Event plus the fit quantities.
+//
+
+
+/**
+    @file Compact_Fit_Result.cc
+
+    @brief Fit_Result held as a Compact_Event plus the fit quantities.
+    See the documentation of header file Compact_Fit_Result.h for details.
+
+ */
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Compact_Fit_Result.h"
+
+
+namespace hitfit {
+
+
+Compact_Fit_Result::Compact_Fit_Result ()
+  : _chisq (-999),
+    _umwhad (0),
+    _utmass (0),
+    _mt (0),
+    _sigmt (0),
+    _pullx (pull_capacity),
+    _pully (pull_capacity)
+{
+  // Assigning a shorter vector keeps the storage of the longer one.
+  _pullx = Column_Vector ();
+  _pully = Column_Vector ();
+}
+
+
+Compact_Fit_Result::Compact_Fit_Result (const Compact_Fit_Result& r)
+  : _chisq (r._chisq),
+    _umwhad (r._umwhad),
+    _utmass (r._utmass),
+    _mt (r._mt),
+    _sigmt (r._sigmt),
+    _pullx (pull_capacity),
+    _pully (pull_capacity),
+    _ev (r._ev)
+{
+  // As above; a plain copy would only hold the pulls of r, and the
+  // results are copied whenever their Scratch_Vector grows.
+  _pullx = r._pullx;
+  _pully = r._pully;
+}
+
+
+void Compact_Fit_Result::assign (double chisq,
+                                 const Compact_Event& unfitted,
+                                 const Lepjets_Event& fitted,
+                                 const Column_Vector& pullx,
+                                 const Column_Vector& pully,
+                                 double umwhad,
+                                 double utmass,
+                                 double mt,
+                                 double sigmt)
+//
+// Purpose: Set the result of fitting UNFITTED into FITTED.  FITTED has
+//          the objects of UNFITTED, with new momenta.
+//
+{
+  assign (chisq, unfitted, pullx, pully, umwhad, utmass, mt, sigmt);
+  _ev.set_momenta (fitted);
+}
+
+
+void Compact_Fit_Result::assign (double chisq,
+                                 const Compact_Event& fitted,
+                                 const Column_Vector& pullx,
+                                 const Column_Vector& pully,
+                                 double umwhad,
+                                 double utmass,
+                                 double mt,
+                                 double sigmt)
+{
+  _chisq = chisq;
+  _umwhad = umwhad;
+  _utmass = utmass;
+  _mt = mt;
+  _sigmt = sigmt;
+  _pullx = pullx;
+  _pully = pully;
+  _ev = fitted;
+}
+
+
+void Compact_Fit_Result::to_result (const Lepjets_Event& source,
+                                    Fit_Result& r, Lepjets_Event& ev) const
+{
+  _ev.to_event (source, ev);
+  r = Fit_Result (_chisq, ev, _pullx, _pully, _umwhad, _utmass, _mt, _sigmt);
+}
+
+
+void Compact_Fit_Result::set_pulls (const Column_Vector& pullx,
+                                    const Column_Vector& pully)
+{
+  _pullx = pullx;
+  _pully = pully;
+}
+
+
+double Compact_Fit_Result::chisq () const
+{
+  return _chisq;
+}
+
+
+double Compact_Fit_Result::umwhad () const
+{
+  return _umwhad;
+}
+
+
+double Compact_Fit_Result::utmass () const
+{
+  return _utmass;
+}
+
+
+double Compact_Fit_Result::mt () const
+{
+  return _mt;
+}
+
+
+double Compact_Fit_Result::sigmt () const
+{
+  return _sigmt;
+}
+
+
+const Column_Vector& Compact_Fit_Result::pullx () const
+{
+  return _pullx;
+}
+
+
+const Column_Vector& Compact_Fit_Result::pully () const
+{
+  return _pully;
+}
+
+
+const Compact_Event& Compact_Fit_Result::ev () const
+{
+  return _ev;
+}
+
+
+} // namespace hitfit
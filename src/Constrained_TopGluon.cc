@@ -38,6 +38,7 @@
 
 #include "MyAna/bpkHitFitForExcitedQuark/interface/Constrained_TopGluon.h"
 #include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPerf.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/Fourvec_Event.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/Defaults.h"
 #include <ostream>
@@ -104,10 +105,11 @@ bool Constrained_TopGluon_Args::equal_side () const
 //*************************************************************************
 
 
-Constrained_TopGluon::Constrained_TopGluon (const Constrained_TopGluon_Args& args,
-                                  double lepw_mass,
-                                  double hadw_mass,
-                                  double top_mass)
+template <class H>
+Constrained_Hypothesis<H>::Constrained_Hypothesis (const Constrained_TopGluon_Args& args,
+                                                   double lepw_mass,
+                                                   double hadw_mass,
+                                                   double top_mass)
 //
 // Purpose: Constructor.
 //
@@ -121,42 +123,26 @@ Constrained_TopGluon::Constrained_TopGluon (const Constrained_TopGluon_Args& arg
 //                 or 0 to skip this constraint.
 //
   : _args (args),
-    _constrainer (args.fourvec_constrainer_args())
+    _constrainer (args.fourvec_constrainer_args()),
+    _perf (0)
 {
-  char buf[256];
-  if (lepw_mass > 0) {
-    sprintf (buf, "(%d %d) = %f", nu_label, lepton_label, lepw_mass);
-    _constrainer.add_constraint (buf);
-  }
-
-  if (hadw_mass > 0) {
-    sprintf (buf, "(%d %d) = %f", hadw1_label, hadw2_label, hadw_mass);
-    _constrainer.add_constraint (buf);
-  }
-
-  if (args.equal_side()) {
-      sprintf (buf, "(%d %d %d %d) = (%d %d %d %d)",
-               nu_label, lepton_label, lepb_label, gluon1_label,
-               hadw1_label, hadw2_label, hadb_label, gluon2_label);
-      std::cout<<"equal_side : "<<buf<<std::endl;
-      _constrainer.add_constraint (buf);
-  }
+  H::add_constraints (_constrainer, args.equal_side(),
+                      lepw_mass, hadw_mass, top_mass);
+}
 
-  if (top_mass > 0) {
-    sprintf (buf, "(%d %d %d) = %f",
-             hadw1_label, hadw2_label, hadb_label, top_mass);
-    _constrainer.add_constraint (buf);
 
-    sprintf (buf, "(%d %d %d) = %f",
-             nu_label, lepton_label, lepb_label, top_mass);
-    _constrainer.add_constraint (buf);
-  }
-
-  sprintf (buf, "(%d %d %d %d) = 0",
-		  hadw1_label, hadw2_label, hadb_label, gluon2_label);
-  _constrainer.mass_constraint (buf);
+template <class H>
+Constrained_Hypothesis<H>::Constrained_Hypothesis (const Constrained_Hypothesis& other)
+//
+// Purpose: Copy constructor, without the stage accounting.
+//
+  : _args (other._args),
+    _constrainer (other._constrainer),
+    _perf (0)
+{
 }
 
+
 namespace {
 
 
@@ -195,7 +181,8 @@ FE_Obj make_fe_obj (const Lepjets_Event_Lep& obj, double mass, int type)
 
 /**
 
-    @brief Convert from a Lepjets_Event to a Fourvec_Event.
+    @brief Convert from a Lepjets_Event to a Fourvec_Event, taking the
+    jets of the types imported by hypothesis H.
 
     @param ev The input event.
 
@@ -211,6 +198,7 @@ FE_Obj make_fe_obj (const Lepjets_Event_Lep& obj, double mass, int type)
     - Fourvec_Event <i>fe</i>.
 
  */
+template <class H>
 void do_import (const Lepjets_Event& ev, double bmass, Fourvec_Event& fe)
 //
 // Purpose: Convert from a Lepjets_Event to a Fourvec_Event.
@@ -229,7 +217,7 @@ void do_import (const Lepjets_Event& ev, double bmass, Fourvec_Event& fe)
   bool saw_lepb = false;
   bool saw_hadb = false;
   for (std::vector<Lepjets_Event_Jet>::size_type j=0; j < ev.njets(); j++) {
-    if (ev.jet(j).type() == isr_label || ev.jet(j).type() == higgs_label)
+    if (!H::imported (ev.jet(j).type()))
       continue;
     double mass = 0;
     if (ev.jet(j).type() == lepb_label && !saw_lepb) {
@@ -267,6 +255,7 @@ void do_import (const Lepjets_Event& ev, double bmass, Fourvec_Event& fe)
     - Lepjets_Event <i>ev</i>
 
  */
+template <class H>
 void do_export (const Fourvec_Event& fe, Lepjets_Event& ev)
 //
 // Purpose: Convert from a Fourvec_Event to a Lepjets_Event.
@@ -281,7 +270,7 @@ void do_export (const Fourvec_Event& fe, Lepjets_Event& ev)
 {
   ev.lep(0).p() = fe.obj(0).p;
   for (std::vector<Lepjets_Event_Jet>::size_type j=0, k=1; j < ev.njets(); j++) {
-    if (ev.jet(j).type() == isr_label || ev.jet(j).type() == higgs_label)
+    if (!H::imported (ev.jet(j).type()))
       continue;
     ev.jet(j).p() = fe.obj(k++).p;
   }
@@ -293,11 +282,12 @@ void do_export (const Fourvec_Event& fe, Lepjets_Event& ev)
 } // unnamed namespace
 
 
-double Constrained_TopGluon::constrain (Lepjets_Event& ev,
-                                   double& mt,
-                                   double& sigmt,
-                                   Column_Vector& pullx,
-                                   Column_Vector& pully)
+template <class H>
+double Constrained_Hypothesis<H>::constrain (Lepjets_Event& ev,
+                                             double& mt,
+                                             double& sigmt,
+                                             Column_Vector& pullx,
+                                             Column_Vector& pully)
 //
 // Purpose: Do a constrained fit for EV.  Returns the top mass and
 //          its error in MT and SIGMT, and the pull quantities in PULLX and
@@ -318,25 +308,55 @@ double Constrained_TopGluon::constrain (Lepjets_Event& ev,
 //   The fit chisq, or < 0 if the fit didn't converge.
 //
 {
+  if (_perf) {
+    bpkHitFitPerf::Sample s0, s1, s2, s3;
+    _perf->Take (s0);
+    Fourvec_Event fe;
+    do_import<H> (ev, _args.bmass (), fe);
+    _perf->Take (s1);
+    double chisq = _constrainer.constrain (fe, mt, sigmt, pullx, pully);
+    _perf->Take (s2);
+    do_export<H> (fe, ev);
+    _perf->Take (s3);
+    _perf->Add (bpkHitFitPerf::import_export, s0, s1);
+    _perf->Add (bpkHitFitPerf::constrainer, s1, s2);
+    _perf->Add (bpkHitFitPerf::import_export, s2, s3, 0);
+    return chisq;
+  }
+
   Fourvec_Event fe;
-  do_import (ev, _args.bmass (), fe);
+  do_import<H> (ev, _args.bmass (), fe);
   double chisq = _constrainer.constrain (fe, mt, sigmt, pullx, pully);
-  do_export (fe, ev);
+  do_export<H> (fe, ev);
 
   return chisq;
 }
 
 
+template <class H>
+void Constrained_Hypothesis<H>::set_perf (bpkHitFitPerf* perf)
+//
+// Purpose: Set the stage accounting, 0 for none.
+//
+// Inputs:
+//   perf -        The accounting, not owned.
+//
+{
+  _perf = perf;
+}
+
+
 /**
-    @brief Output stream operator, print the content of this Constrained_TopGluon
-    object to an output stream.
+    @brief Output stream operator, print the content of this
+    Constrained_Hypothesis object to an output stream.
 
     @param s The output stream to which to write.
 
-    @param ct The instance of Constrained_TopGluon to be printed.
+    @param ct The instance of Constrained_Hypothesis to be printed.
 
 */
-std::ostream& operator<< (std::ostream& s, const Constrained_TopGluon& ct)
+template <class H>
+std::ostream& operator<< (std::ostream& s, const Constrained_Hypothesis<H>& ct)
 //
 // Purpose: Print the object to S.
 //
@@ -352,4 +372,13 @@ std::ostream& operator<< (std::ostream& s, const Constrained_TopGluon& ct)
 }
 
 
+template class Constrained_Hypothesis<TTbar_Hypothesis>;
+template class Constrained_Hypothesis<TopGluon_Hypothesis>;
+template class Constrained_Hypothesis<TTH_Hypothesis>;
+
+template std::ostream& operator<< (std::ostream&, const Constrained_Hypothesis<TTbar_Hypothesis>&);
+template std::ostream& operator<< (std::ostream&, const Constrained_Hypothesis<TopGluon_Hypothesis>&);
+template std::ostream& operator<< (std::ostream&, const Constrained_Hypothesis<TTH_Hypothesis>&);
+
+
 } // namespace hitfit
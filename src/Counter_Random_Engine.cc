@@ -0,0 +1,150 @@
+#include <fstream>
+#include <iostream>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Counter_Random_Engine.h"
+
+namespace hitfit{
+
+  namespace {
+
+    const uint32_t PHILOX_M0 = 0xD2511F53;
+    const uint32_t PHILOX_M1 = 0xCD9E8D57;
+    const uint32_t PHILOX_W0 = 0x9E3779B9;
+    const uint32_t PHILOX_W1 = 0xBB67AE85;
+
+    void MulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+    {
+      uint64_t p = uint64_t(a) * b;
+      hi = uint32_t(p >> 32);
+      lo = uint32_t(p);
+    }
+
+    // Philox4x32 with 10 rounds on counter ctr and key (k0, k1).
+    void Philox4x32(uint32_t ctr[4], uint32_t k0, uint32_t k1)
+    {
+      for (int round = 0 ; round != 10; round++) {
+	uint32_t hi0, lo0, hi1, lo1;
+	MulHiLo(PHILOX_M0, ctr[0], hi0, lo0);
+	MulHiLo(PHILOX_M1, ctr[2], hi1, lo1);
+	uint32_t c0 = hi1 ^ ctr[1] ^ k0;
+	uint32_t c2 = hi0 ^ ctr[3] ^ k1;
+	ctr[0] = c0;
+	ctr[1] = lo1;
+	ctr[2] = c2;
+	ctr[3] = lo0;
+	k0 += PHILOX_W0;
+	k1 += PHILOX_W1;
+      }
+    }
+
+    // 53 random bits from two words, mapped into (0, 1).
+    double ToDouble(uint32_t hi, uint32_t lo)
+    {
+      uint64_t bits = ((uint64_t(hi) << 32) | lo) >> 11;
+      return (double(bits) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+  } // unnamed namespace
+
+  Counter_Random_Engine::Counter_Random_Engine(uint64_t key, uint64_t stream)
+  {
+    reset(key, stream);
+  }
+
+  Counter_Random_Engine::~Counter_Random_Engine()
+  {
+  }
+
+  void Counter_Random_Engine::reset(uint64_t key, uint64_t stream)
+  {
+    _key    = key;
+    _stream = stream;
+    _block  = 0;
+    _used   = 2;
+    theSeed = long(key);
+  }
+
+  uint64_t Counter_Random_Engine::key() const
+  {
+    return _key;
+  }
+
+  uint64_t Counter_Random_Engine::stream() const
+  {
+    return _stream;
+  }
+
+  uint64_t Counter_Random_Engine::position() const
+  {
+    return 2 * _block - (2 - _used);
+  }
+
+  void Counter_Random_Engine::next_block()
+  {
+    uint32_t ctr[4] = { uint32_t(_block), uint32_t(_block >> 32),
+			uint32_t(_stream), uint32_t(_stream >> 32) };
+    Philox4x32(ctr, uint32_t(_key), uint32_t(_key >> 32));
+    _buffer[0] = ToDouble(ctr[0], ctr[1]);
+    _buffer[1] = ToDouble(ctr[2], ctr[3]);
+    _used = 0;
+    ++_block;
+  }
+
+  double Counter_Random_Engine::flat()
+  {
+    if (_used == 2) next_block();
+    return _buffer[_used++];
+  }
+
+  void Counter_Random_Engine::flatArray(const int size, double* vect)
+  {
+    for (int i = 0 ; i != size; i++) vect[i] = flat();
+  }
+
+  void Counter_Random_Engine::setSeed(long seed, int /*extra*/)
+  {
+    reset(uint64_t(seed), _stream);
+  }
+
+  void Counter_Random_Engine::setSeeds(const long* seeds, int /*extra*/)
+  {
+    // CLHEP seed lists are terminated by 0.
+    if (seeds == 0 || seeds[0] == 0) return;
+    reset(uint64_t(seeds[0]), seeds[1] == 0 ? 0 : uint64_t(seeds[1]));
+  }
+
+  void Counter_Random_Engine::saveStatus(const char filename[]) const
+  {
+    std::ofstream out(filename);
+    out << name() << "\n" << _key << " " << _stream << " " << position() << "\n";
+  }
+
+  void Counter_Random_Engine::restoreStatus(const char filename[])
+  {
+    std::ifstream in(filename);
+    std::string engine;
+    uint64_t key, stream, pos;
+    if (!(in >> engine >> key >> stream >> pos) || engine != name()) {
+      std::cerr << "Counter_Random_Engine::restoreStatus: cannot read " << filename << std::endl;
+      return;
+    }
+    reset(key, stream);
+    _block = pos / 2;
+    if (pos % 2) {
+      next_block();
+      _used = 1;
+    }
+  }
+
+  void Counter_Random_Engine::showStatus() const
+  {
+    std::cout << name() << ": key " << _key << " stream " << _stream
+	      << " position " << position() << std::endl;
+  }
+
+  std::string Counter_Random_Engine::name() const
+  {
+    return "Counter_Random_Engine";
+  }
+
+} // namespace hitfit
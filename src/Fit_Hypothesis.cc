@@ -0,0 +1,163 @@
+//
+// File: src/Fit_Hypothesis.cc
+// Purpose: Jet slots and constraints of the fit hypotheses.
+//
+
+
+/**
+    @file Fit_Hypothesis.cc
+
+    @brief Jet slots and constraints of the fit hypotheses.  See the
+    documentation for the header file Fit_Hypothesis.h for details.
+
+ */
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Fit_Hypothesis.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/Fourvec_Constrainer.h"
+#include <iostream>
+#include <stdio.h>
+
+
+namespace hitfit {
+
+
+namespace {
+
+
+/**
+    @brief Helper function: the W mass constraints common to all
+    hypotheses.
+ */
+void add_w_constraints (Fourvec_Constrainer& c,
+                        double lepw_mass,
+                        double hadw_mass)
+{
+  char buf[256];
+  if (lepw_mass > 0) {
+    sprintf (buf, "(%d %d) = %f", nu_label, lepton_label, lepw_mass);
+    c.add_constraint (buf);
+  }
+
+  if (hadw_mass > 0) {
+    sprintf (buf, "(%d %d) = %f", hadw1_label, hadw2_label, hadw_mass);
+    c.add_constraint (buf);
+  }
+}
+
+
+/**
+    @brief Helper function: the top mass constraints common to all
+    hypotheses.
+ */
+void add_top_constraints (Fourvec_Constrainer& c,
+                          double top_mass)
+{
+  char buf[256];
+  if (top_mass > 0) {
+    sprintf (buf, "(%d %d %d) = %f",
+             hadw1_label, hadw2_label, hadb_label, top_mass);
+    c.add_constraint (buf);
+
+    sprintf (buf, "(%d %d %d) = %f",
+             nu_label, lepton_label, lepb_label, top_mass);
+    c.add_constraint (buf);
+  }
+}
+
+
+/**
+    @brief Helper function: the ttbar constraints, with the hadronic
+    top as fit mass.  The equal mass constraint of the two sides is
+    only added without a top mass, which fixes both sides already.
+ */
+void add_ttbar_constraints (Fourvec_Constrainer& c,
+                            bool equal_side,
+                            double lepw_mass,
+                            double hadw_mass,
+                            double top_mass)
+{
+  add_w_constraints (c, lepw_mass, hadw_mass);
+  add_top_constraints (c, top_mass);
+
+  char buf[256];
+  if (equal_side && top_mass <= 0) {
+    sprintf (buf, "(%d %d %d) = (%d %d %d)",
+             nu_label, lepton_label, lepb_label,
+             hadw1_label, hadw2_label, hadb_label);
+    c.add_constraint (buf);
+  }
+
+  sprintf (buf, "(%d %d %d) = 0", hadw1_label, hadw2_label, hadb_label);
+  c.mass_constraint (buf);
+}
+
+
+} // unnamed namespace
+
+
+const int TTbar_Hypothesis::slots[TTbar_Hypothesis::njets] = {
+  lepb_label, hadb_label, hadw1_label, hadw1_label
+};
+
+
+const int TopGluon_Hypothesis::slots[TopGluon_Hypothesis::njets] = {
+  lepb_label, hadb_label, hadw1_label, hadw1_label, gluon1_label, gluon2_label
+};
+
+
+const int TTH_Hypothesis::slots[TTH_Hypothesis::njets] = {
+  lepb_label, hadb_label, hadw1_label, hadw1_label, higgs_label, higgs_label
+};
+
+
+void TTbar_Hypothesis::add_constraints (Fourvec_Constrainer& c,
+                                        bool equal_side,
+                                        double lepw_mass,
+                                        double hadw_mass,
+                                        double top_mass)
+{
+  add_ttbar_constraints (c, equal_side, lepw_mass, hadw_mass, top_mass);
+}
+
+
+void TopGluon_Hypothesis::add_constraints (Fourvec_Constrainer& c,
+                                           bool equal_side,
+                                           double lepw_mass,
+                                           double hadw_mass,
+                                           double top_mass)
+//
+// Purpose: The constraints of Constrained_TopGluon: the W and top
+//          masses, the two t+g systems of equal mass if requested, and
+//          the hadronic t+g system as fit mass.
+//
+{
+  add_w_constraints (c, lepw_mass, hadw_mass);
+
+  char buf[256];
+  if (equal_side) {
+    sprintf (buf, "(%d %d %d %d) = (%d %d %d %d)",
+             nu_label, lepton_label, lepb_label, gluon1_label,
+             hadw1_label, hadw2_label, hadb_label, gluon2_label);
+    std::cout << "equal_side : " << buf << std::endl;
+    c.add_constraint (buf);
+  }
+
+  add_top_constraints (c, top_mass);
+
+  sprintf (buf, "(%d %d %d %d) = 0",
+           hadw1_label, hadw2_label, hadb_label, gluon2_label);
+  c.mass_constraint (buf);
+}
+
+
+void TTH_Hypothesis::add_constraints (Fourvec_Constrainer& c,
+                                      bool equal_side,
+                                      double lepw_mass,
+                                      double hadw_mass,
+                                      double top_mass)
+{
+  add_ttbar_constraints (c, equal_side, lepw_mass, hadw_mass, top_mass);
+}
+
+
+} // namespace hitfit
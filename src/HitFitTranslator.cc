@@ -17,6 +17,7 @@ namespace hitfit {
     resolution_filename = CMSSW_BASE +
       std::string("/src/TopQuarkAnalysis/TopHitFit/data/resolution/tqafMuonResolution.txt");
     muonResolution_ = EtaDepResolution(resolution_filename);
+    BuildTable();
 
   } // LeptonTranslator::LeptonTranslator()
 
@@ -42,6 +43,7 @@ namespace hitfit {
       resolution_filename = mufile ;
     }
     muonResolution_ = EtaDepResolution(resolution_filename);
+    BuildTable();
 
   } // LeptonTranslator::LeptonTranslator(const std::string& elfile, const std::strin& mufile)
 
@@ -51,6 +53,16 @@ namespace hitfit {
   }
 
 
+  void
+  LeptonTranslator::BuildTable()
+  {
+    Resolution_Table* table = new Resolution_Table;
+    electronGroup_ = table->add(electronResolution_);
+    muonGroup_     = table->add(muonResolution_);
+    table_.reset(table);
+  }
+
+
   Lepjets_Event_Lep
   LeptonTranslator::operator()(const LepInfoBranches& leptons,
 			       const int index,
@@ -58,21 +70,35 @@ namespace hitfit {
 			       bool useObjEmbRes /* = false */)
   {
 
-    Fourvec p(leptons.Px[index],leptons.Py[index],leptons.Pz[index],leptons.Energy[index]);
+    return (*this)(bpkHitFitInput::MakeLepton(leptons,index),type,useObjEmbRes);
+
+  } // Lepjets_Event_Lep LeptonTranslator::operator()
+
+
+  Lepjets_Event_Lep
+  LeptonTranslator::operator()(const bpkHitFitLepton& lepton,
+			       int type /* = hitfit::lepton_label */,
+			       bool useObjEmbRes /* = false */)
+  {
+
+    Fourvec p(lepton.Px,lepton.Py,lepton.Pz,lepton.Energy);
 
-    double            lepton_eta        = leptons.Eta[index];
+    double            lepton_eta        = lepton.Eta;
     Vector_Resolution lepton_resolution;
-    if(leptons.LeptonType[index]==11)
+    int k = ResolutionIndex(lepton);
+    if(k>=0)
+      lepton_resolution = (*table_)[k];
+    else if(lepton.LeptonType==11)   // outside the eta bins, let EtaDepResolution complain
       lepton_resolution = electronResolution_.GetResolution(lepton_eta);
-    else if(leptons.LeptonType[index]==13)
+    else if(lepton.LeptonType==13)
       lepton_resolution = muonResolution_.GetResolution(lepton_eta);
 
-    Lepjets_Event_Lep lepton(p,
-			     lepton_label,
-			     lepton_resolution);
-    return lepton;
+    Lepjets_Event_Lep retlepton(p,
+				lepton_label,
+				lepton_resolution);
+    return retlepton;
 
-  } // Lepjets_Event_Lep LeptonTranslator::operator()
+  } // Lepjets_Event_Lep LeptonTranslator::operator()(const bpkHitFitLepton& lepton)
 
 
   const EtaDepResolution&
@@ -87,6 +113,23 @@ namespace hitfit {
     return muonResolution_;
   }
 
+  const Resolution_Table&
+  LeptonTranslator::resolutionTable() const
+  {
+    return *table_;
+  }
+
+  int
+  LeptonTranslator::ResolutionIndex(const bpkHitFitLepton& lepton) const
+  {
+    if(lepton.LeptonType==11)
+      return table_->index(electronGroup_, lepton.Eta);
+    else if(lepton.LeptonType==13)
+      return table_->index(muonGroup_, lepton.Eta);
+    else
+      return -1;
+  }
+
   bool
   LeptonTranslator::CheckEta(const LepInfoBranches& leptons, const int index) const
   {
@@ -112,6 +155,7 @@ namespace hitfit {
     jetCorrectionLevel_ = "L7Parton";
     jes_  = 1.0;
     jesB_ = 1.0;
+    BuildTable();
 
   } // JetTranslator::JetTranslator()
 
@@ -143,6 +187,7 @@ namespace hitfit {
     jetCorrectionLevel_ = "L7Parton";
     jes_  = 1.0;
     jesB_ = 1.0;
+    BuildTable();
 
   } // JetTranslator::JetTranslator(const std::string& ifile)
 
@@ -176,6 +221,7 @@ namespace hitfit {
     jetCorrectionLevel_ = jetCorrectionLevel;
     jes_  = jes;
     jesB_ = jesB;
+    BuildTable();
 
   } // JetTranslator::JetTranslator(const std::string& ifile)
 
@@ -184,6 +230,16 @@ namespace hitfit {
   } // JetTranslator::~JetTranslator()
 
 
+  void
+  JetTranslator::BuildTable()
+  {
+    Resolution_Table* table = new Resolution_Table;
+    udscGroup_ = table->add(udscResolution_);
+    bGroup_    = table->add(bResolution_);
+    table_.reset(table);
+  }
+
+
   Lepjets_Event_Jet
   JetTranslator::operator()(const JetInfoBranches& jets,
 			    const int index,
@@ -191,35 +247,48 @@ namespace hitfit {
 			    bool useObjEmbRes /* = false */)
   {
 
+    return (*this)(bpkHitFitInput::MakeJet(jets,index),type,useObjEmbRes);
+
+  } // Lepjets_Event_Jet JetTranslator::operator()(const pat::Jet& j,int type)
+
+
+  Lepjets_Event_Jet
+  JetTranslator::operator()(const bpkHitFitJet& jet,
+			    int type /*= hitfit::unknown_label */,
+			    bool useObjEmbRes /* = false */)
+  {
+
     Fourvec p;
 
-    double            jet_eta        = jets.Eta[index];
+    double            jet_eta        = jet.Eta;
 
     Vector_Resolution jet_resolution;
+    int k = ResolutionIndex(jet, type);
 
     if (type == hitfit::hadb_label || type == hitfit::lepb_label || type == hitfit::higgs_label) {
-      jet_resolution = bResolution_.GetResolution(jet_eta);
+      // Outside the eta bins, let EtaDepResolution complain
+      jet_resolution = k>=0 ? (*table_)[k] : bResolution_.GetResolution(jet_eta);
 
-      //float scale = jets.Pt[index]>0. ? jesB_*jets.PtCorrL7b[index] / jets.Pt[index] : 0.;
+      //float scale = jet.Pt>0. ? jesB_*jet.PtCorrL7b / jet.Pt : 0.;
       float scale = jesB_;
-      if(jets.Pt[index]>0.) {
-	if(jetCorrectionLevel_.find("L7")!=std::string::npos) scale*=jets.PtCorrL7b[index] / jets.Pt[index];
-	else if(jetCorrectionLevel_.find("L3")!=std::string::npos) scale*=jets.PtCorrL3[index] / jets.Pt[index];
+      if(jet.Pt>0.) {
+	if(jetCorrectionLevel_.find("L7")!=std::string::npos) scale*=jet.PtCorrL7b / jet.Pt;
+	else if(jetCorrectionLevel_.find("L3")!=std::string::npos) scale*=jet.PtCorrL3 / jet.Pt;
       }
 
-      p = Fourvec(jets.Px[index]*scale,jets.Py[index]*scale,jets.Pz[index]*scale,jets.Energy[index]*scale);
+      p = Fourvec(jet.Px*scale,jet.Py*scale,jet.Pz*scale,jet.Energy*scale);
 
     } else {
-      jet_resolution = udscResolution_.GetResolution(jet_eta);
+      jet_resolution = k>=0 ? (*table_)[k] : udscResolution_.GetResolution(jet_eta);
 
-      //float scale = jets.Pt[index]>0. ? jes_*jets.PtCorrL7uds[index] / jets.Pt[index] : 0.;
+      //float scale = jet.Pt>0. ? jes_*jet.PtCorrL7uds / jet.Pt : 0.;
       float scale = jes_;
-      if(jets.Pt[index]>0.) {
-	if(jetCorrectionLevel_.find("L7")!=std::string::npos) scale*=jets.PtCorrL7uds[index] / jets.Pt[index];
-	else if(jetCorrectionLevel_.find("L3")!=std::string::npos) scale*=jets.PtCorrL3[index] / jets.Pt[index];
+      if(jet.Pt>0.) {
+	if(jetCorrectionLevel_.find("L7")!=std::string::npos) scale*=jet.PtCorrL7uds / jet.Pt;
+	else if(jetCorrectionLevel_.find("L3")!=std::string::npos) scale*=jet.PtCorrL3 / jet.Pt;
       }
 
-      p = Fourvec(jets.Px[index]*scale,jets.Py[index]*scale,jets.Pz[index]*scale,jets.Energy[index]*scale);
+      p = Fourvec(jet.Px*scale,jet.Py*scale,jet.Pz*scale,jet.Energy*scale);
     }
 
     Lepjets_Event_Jet retjet(p,
@@ -227,7 +296,7 @@ namespace hitfit {
                              jet_resolution);
     return retjet;
 
-  } // Lepjets_Event_Jet JetTranslator::operator()(const pat::Jet& j,int type)
+  } // Lepjets_Event_Jet JetTranslator::operator()(const bpkHitFitJet& jet,int type)
 
 
   const EtaDepResolution&
@@ -244,6 +313,23 @@ namespace hitfit {
   }
 
 
+  const Resolution_Table&
+  JetTranslator::resolutionTable() const
+  {
+    return *table_;
+  }
+
+
+  int
+  JetTranslator::ResolutionIndex(const bpkHitFitJet& jet, int type) const
+  {
+    if (type == hitfit::hadb_label || type == hitfit::lepb_label || type == hitfit::higgs_label)
+      return table_->index(bGroup_, jet.Eta);
+    else
+      return table_->index(udscGroup_, jet.Eta);
+  }
+
+
   bool
   JetTranslator::CheckEta(const JetInfoBranches& jets, const int index) const
   {
@@ -251,6 +337,27 @@ namespace hitfit {
     return bResolution_.CheckEta(jet_eta) && udscResolution_.CheckEta(jet_eta);
   }
 
+  void
+  JetTranslator::SetJES(double jes, double jesB)
+  {
+    jes_  = jes;
+    jesB_ = jesB;
+  }
+
+
+  double
+  JetTranslator::jes() const
+  {
+    return jes_;
+  }
+
+
+  double
+  JetTranslator::jesB() const
+  {
+    return jesB_;
+  }
+
   // METTranslator
   METTranslator::METTranslator()
   {
@@ -280,6 +387,14 @@ namespace hitfit {
   } // Fourvec METTranslator::operator()(const EvtInfoBranches& evt)
 
 
+  Fourvec
+  METTranslator::operator()(const bpkHitFitInput& evt,
+			    bool useObjEmbRes /* = false */)
+  {
+    return Fourvec (evt.PFMETx,evt.PFMETy,0.0,evt.PFMET);
+  } // Fourvec METTranslator::operator()(const bpkHitFitInput& evt)
+
+
   Resolution
   METTranslator::KtResolution(const EvtInfoBranches& evt,
 			      bool useObjEmbRes /* = false */) const
@@ -288,6 +403,14 @@ namespace hitfit {
   } // Resolution METTranslator::KtResolution(const EvtInfoBranches& evt)
 
 
+  Resolution
+  METTranslator::KtResolution(const bpkHitFitInput& evt,
+			      bool useObjEmbRes /* = false */) const
+  {
+    return resolution_;
+  } // Resolution METTranslator::KtResolution(const bpkHitFitInput& evt)
+
+
   Resolution
   METTranslator::METResolution(const EvtInfoBranches& evt,
 			       bool useObjEmbRes /* = false */) const
@@ -409,6 +409,29 @@ void Lepjets_Event::add_jet (const Lepjets_Event_Jet& jet)
 }
 
 
+void Lepjets_Event::clear (int runnum /*= 0*/, int evnum /*= 0*/)
+//
+// Purpose: Remove all objects and reset the event state.
+//          The lepton and jet lists keep their capacity.
+//
+// Inputs:
+//   runnum -      The new run number.
+//   evnum -       The new event number.
+//
+{
+  _leps.clear ();
+  _jets.clear ();
+  _met = Fourvec ();
+  _kt_res = Resolution ();
+  _zvertex = 0;
+  _isMC = false;
+  _runnum = runnum;
+  _evnum = evnum;
+  _dlb = -1;
+  _dnn = -1;
+}
+
+
 void Lepjets_Event::smear (CLHEP::HepRandomEngine& engine, bool smear_dir /*= false*/)
 //
 // Purpose: Smear the objects in the event according to their resolutions.
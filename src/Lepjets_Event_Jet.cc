@@ -325,4 +325,51 @@ jetTypeString(int j)
 
 }
 
+int
+jetPermutationCode(const std::vector<int>& jet_types)
+//
+// Purpose: Encode a jet permutation into an integer
+//
+// Inputs:
+//   jet_types -  jet types in a vector of integer
+//
+// Returns:
+//   one octal digit per jet, first jet least significant
+//
+{
+
+    int code = 0;
+
+    for (size_t j = jet_types.size() ; j != 0 ; --j) {
+
+        int digit;
+
+        switch (jet_types[j-1]) {
+
+        case hitfit::isr_label:
+            digit = 0; break;
+        case hitfit::lepb_label:
+            digit = 1; break;
+        case hitfit::hadb_label:
+            digit = 2; break;
+        case hitfit::hadw1_label:
+        case hitfit::hadw2_label:
+            digit = 3; break;
+        case hitfit::higgs_label:
+            digit = 4; break;
+        case hitfit::gluon1_label:
+            digit = 5; break;
+        case hitfit::gluon2_label:
+            digit = 6; break;
+        default:
+            digit = 7; break;
+        }
+
+        code = code * 8 + digit;
+    }
+
+    return code;
+
+}
+
 } // namespace hitfit
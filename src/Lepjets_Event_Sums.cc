@@ -0,0 +1,141 @@
+//
+// File: src/Lepjets_Event_Sums.cc
+// Purpose: Per-label four-momentum sums of a Lepjets_Event.
+//
+
+
+/**
+    @file Lepjets_Event_Sums.cc
+
+    @brief Per-label four-momentum sums of a Lepjets_Event.  See the
+    documentation of header file Lepjets_Event_Sums.h for details.
+
+ */
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Lepjets_Event_Sums.h"
+
+
+namespace hitfit {
+
+
+Lepjets_Event_Sums::Lepjets_Event_Sums ()
+{
+}
+
+
+Lepjets_Event_Sums::Lepjets_Event_Sums (const Lepjets_Event& ev)
+{
+  reset (ev);
+}
+
+
+void Lepjets_Event_Sums::add (int type, const Fourvec& p)
+//
+// Purpose: Add P to the sum of type code TYPE.
+//
+{
+  if (type >= 0 && type < n_types)
+    _sums[type] += p;
+}
+
+
+void Lepjets_Event_Sums::reset (const Lepjets_Event& ev)
+//
+// Purpose: Sum the objects of EV by type code.
+//
+{
+  for (int t = 0; t < n_types; t++)
+    _sums[t] = Fourvec ();
+
+  for (std::vector<Lepjets_Event_Lep>::size_type i=0; i < ev.nleps(); i++)
+    add (ev.lep(i).type(), ev.lep(i).p());
+  for (std::vector<Lepjets_Event_Jet>::size_type i=0; i < ev.njets(); i++)
+    add (ev.jet(i).type(), ev.jet(i).p());
+  _met = ev.met();
+}
+
+
+void Lepjets_Event_Sums::reset (const Compact_Event& ev)
+//
+// Purpose: Sum the objects of EV by type code.
+//
+{
+  for (int t = 0; t < n_types; t++)
+    _sums[t] = Fourvec ();
+
+  for (std::vector<double>::size_type i=0; i < ev.nobjs(); i++)
+    add (ev.type[i], ev.p(i));
+  _met = ev.met();
+}
+
+
+void Lepjets_Event_Sums::set_met (const Fourvec& met)
+{
+  _met = met;
+}
+
+
+Fourvec Lepjets_Event_Sums::sum (int type) const
+{
+  if (type >= 0 && type < n_types)
+    return _sums[type];
+  return Fourvec ();
+}
+
+
+Fourvec Lepjets_Event_Sums::hadw () const
+{
+  return _sums[hadw1_label] + _sums[hadw2_label];
+}
+
+
+Fourvec Lepjets_Event_Sums::hadt () const
+{
+  return hadw () + _sums[hadb_label];
+}
+
+
+Fourvec Lepjets_Event_Sums::lepw () const
+{
+  return _sums[lepton_label] + _sums[electron_label] + _sums[muon_label] + _met;
+}
+
+
+Fourvec Lepjets_Event_Sums::lept () const
+{
+  return lepw () + _sums[lepb_label];
+}
+
+
+void Lepjets_Event_Sums::masses (Decay_Masses& m) const
+{
+  Fourvec w = hadw ();
+  Fourvec th = w + _sums[hadb_label];
+  Fourvec tl = lept ();
+  m.hadw = w.m();
+  m.hadt = th.m();
+  m.lept = tl.m();
+  m.tg_lep = (tl + _sums[gluon1_label]).m();
+  m.tg_had = (th + _sums[gluon2_label]).m();
+}
+
+
+Decay_Masses Lepjets_Event_Sums::decay_masses (const Lepjets_Event& ev)
+{
+  Decay_Masses m;
+  Lepjets_Event_Sums (ev).masses (m);
+  return m;
+}
+
+
+Decay_Masses Lepjets_Event_Sums::decay_masses (const Compact_Event& ev)
+{
+  Decay_Masses m;
+  Lepjets_Event_Sums sums;
+  sums.reset (ev);
+  sums.masses (m);
+  return m;
+}
+
+
+} // namespace hitfit
@@ -0,0 +1,76 @@
+//
+// File: src/Resolution_Table.cc
+// Purpose: Lookup table of the eta-binned resolutions of a translator.
+//
+
+
+/**
+    @file Resolution_Table.cc
+
+    @brief Lookup table of the eta-binned resolutions of a translator.
+    See the documentation of header file Resolution_Table.h for details.
+
+ */
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Resolution_Table.h"
+
+
+namespace hitfit {
+
+
+Resolution_Table::Resolution_Table ()
+  : _first (1, 0)
+{
+}
+
+
+int Resolution_Table::add (const EtaDepResolution& res)
+//
+// Purpose: Add the eta bins of RES as a new group, keeping the order
+//          EtaDepResolution searches them in.
+//
+{
+  const std::vector<EtaDepResElement> elements = res.GetEtaDepResElement();
+  for (std::vector<EtaDepResElement>::size_type i=0; i < elements.size(); i++) {
+    _elements.push_back (elements[i]);
+    _resolutions.push_back (elements[i].GetResolution());
+  }
+  _first.push_back (_elements.size());
+  return ngroups() - 1;
+}
+
+
+int Resolution_Table::index (int group, double eta) const
+//
+// Purpose: Find the entry of GROUP for ETA, the first bin containing
+//          it or having it on an edge, as for
+//          EtaDepResolution::GetResolution().
+//
+{
+  for (size_type i=_first[group]; i < _first[group+1]; i++) {
+    if (_elements[i].IsInInterval (eta) || _elements[i].IsOnEdge (eta))
+      return i;
+  }
+  return -1;
+}
+
+
+const Vector_Resolution& Resolution_Table::operator[] (size_type i) const
+{
+  return _resolutions[i];
+}
+
+
+Resolution_Table::size_type Resolution_Table::size () const
+{
+  return _resolutions.size();
+}
+
+
+int Resolution_Table::ngroups () const
+{
+  return _first.size() - 1;
+}
+
+
+} // namespace hitfit
@@ -188,7 +188,7 @@ namespace {
     @brief Helper function: apply mass cuts to see if this
     event should be rejected before fitting.
 
-    @param ev The event to test.
+    @param ev The object sums of the event to test.
 
     @param args The parameter settings.
 
@@ -198,7 +198,7 @@ namespace {
 
     @param umtlep The mass of the leptonic top quark before fit.
  */
-bool test_for_bad_masses (const Lepjets_Event& ev,
+bool test_for_bad_masses (const Lepjets_Event_Sums& ev,
                           const TopGluon_Fit_Args& args,
                           double mwhad,
                           double umthad,
@@ -208,7 +208,7 @@ bool test_for_bad_masses (const Lepjets_Event& ev,
 //          without fitting.
 //
 // Inputs:
-//   ev -          The event to test.
+//   ev -          The object sums of the event to test.
 //   args -        Parameter setting.
 //   mwhad -       The hadronic W mass.
 //   umthad -      The hadronic top mass.
@@ -365,7 +365,8 @@ void set_jet_types (const vector<int>& jet_types,
 //*************************************************************************
 
 
-TopGluon_Fit::TopGluon_Fit (const TopGluon_Fit_Args& args,
+template <class H>
+Hypothesis_Fit<H>::Hypothesis_Fit (const TopGluon_Fit_Args& args,
                   double lepw_mass,
                   double hadw_mass,
                   double top_mass)
@@ -390,7 +391,8 @@ TopGluon_Fit::TopGluon_Fit (const TopGluon_Fit_Args& args,
 }
 
 
-double TopGluon_Fit::fit_one_perm (Lepjets_Event& ev,
+template <class H>
+double Hypothesis_Fit<H>::fit_one_perm (Lepjets_Event& ev,
                               bool& nuz,
                               double& umwhad,
                               double& utmass,
@@ -431,13 +433,75 @@ double TopGluon_Fit::fit_one_perm (Lepjets_Event& ev,
   mt = 0;
   sigmt = 0;
 
+  // Maybe reject this event.
+  if (!prepare_one_perm (ev, nuz, umwhad, utmass)) {
+    pullx = Column_Vector ();
+    pully = Column_Vector ();
+    return -999;
+  }
+
+  // Do the fit.
+  return constrain_one_perm (ev, mt, sigmt, pullx, pully);
+}
+
+
+template <class H>
+bool Hypothesis_Fit<H>::prepare_one_perm (Lepjets_Event& ev,
+                                     bool nuz,
+                                     double& umwhad,
+                                     double& utmass)
+//
+// Purpose: Set up a single jet permutation for the fit: solve for
+//          the neutrino pz and apply the mass cuts.  Nothing done here
+//          depends on the mass constraints of the fit.
+//
+// Inputs:
+//   ev -          The event to fit.
+//                 The object labels must have already been assigned.
+//   nuz -         Which neutrino solution to use, as in fit_one_perm.
+//
+// Outputs:
+//   ev-           The event with the neutrino pz set.
+//   umwhad -      Hadronic W mass before fitting.
+//   utmass -      Top mass before fitting, averaged from both sides.
+//
+// Returns:
+//   False if the permutation fails the mass cuts and should not be fit.
+//
+{
+  double umthad, nuz1, nuz2;
+  solve_one_perm (ev, umwhad, umthad, nuz1, nuz2);
+
+  // Set up to use the selected neutrino solution
+  return prepare_solved_perm (ev, nuz ? nuz2 : nuz1, umwhad, umthad, utmass);
+}
+
+
+template <class H>
+void Hypothesis_Fit<H>::solve_one_perm (const Lepjets_Event& ev,
+                                   double& umwhad,
+                                   double& umthad,
+                                   double& nuz1,
+                                   double& nuz2)
+//
+// Purpose: Solve for the neutrino pz of a single jet permutation.
+//
+// Inputs:
+//   ev -          The event to fit.
+//                 The object labels must have already been assigned.
+//
+// Outputs:
+//   umwhad -      Hadronic W mass before fitting.
+//   umthad -      Hadronic top mass before fitting.
+//   nuz1 -        Neutrino pz for nuz = false.
+//   nuz2 -        Neutrino pz for nuz = true.
+//
+{
   // Find the neutrino solutions by requiring either:
   // 1) that the leptonic top have the same mass as the hadronic top.
   // 2) that the mass of the lepton and neutrino is equal to the W mass
 
-  umwhad = Top_Decaykin::hadw (ev) . m();
-  double umthad = Top_Decaykin::hadt (ev) . m();
-  double nuz1, nuz2;
+  sum_one_perm (ev, umwhad, umthad);
 
   if (_args.solve_nu_tmass()) {
       Top_Decaykin::solve_nu_tmass (ev, umthad, nuz1, nuz2);
@@ -445,14 +509,60 @@ double TopGluon_Fit::fit_one_perm (Lepjets_Event& ev,
   else {
       Top_Decaykin::solve_nu (ev, _lepw_mass, nuz1, nuz2);
   }
+}
 
-  // Set up to use the selected neutrino solution
-  if (!nuz) {
-      ev.met().setZ(nuz1);
-  }
-  else {
-      ev.met().setZ(nuz2);
-  }
+
+template <class H>
+void Hypothesis_Fit<H>::sum_one_perm (const Lepjets_Event& ev,
+                                      double& umwhad,
+                                      double& umthad)
+//
+// Purpose: Sum the objects of a single jet permutation and find its
+//          unfitted masses.
+//
+// Inputs:
+//   ev -          The event to fit.
+//                 The object labels must have already been assigned.
+//
+// Outputs:
+//   umwhad -      Hadronic W mass before fitting.
+//   umthad -      Hadronic top mass before fitting.
+//
+{
+  // Sum the objects by type once; the masses below and the ones
+  // prepare_solved_perm needs are all taken from these sums.
+  _sums.reset (ev);
+  _sums.masses (_masses);
+  umwhad = _masses.hadw;
+  umthad = _masses.hadt;
+}
+
+
+template <class H>
+bool Hypothesis_Fit<H>::prepare_solved_perm (Lepjets_Event& ev,
+                                        double nuz,
+                                        double umwhad,
+                                        double umthad,
+                                        double& utmass)
+//
+// Purpose: Set the neutrino pz found by solve_one_perm and apply the
+//          mass cuts.
+//
+// Inputs:
+//   ev -          The event to fit.
+//   nuz -         The neutrino pz.
+//   umwhad -      Hadronic W mass before fitting.
+//   umthad -      Hadronic top mass before fitting.
+//
+// Outputs:
+//   ev-           The event with the neutrino pz set.
+//   utmass -      Top mass before fitting, averaged from both sides.
+//
+// Returns:
+//   False if the permutation fails the mass cuts and should not be fit.
+//
+{
+  ev.met().setZ(nuz);
 
   // Note: We have set the neutrino Pz, but we haven't set the neutrino energy.
   // Remember that originally the neutrino energy was equal to
@@ -462,31 +572,61 @@ double TopGluon_Fit::fit_one_perm (Lepjets_Event& ev,
   // make its mass remain zero.
 
   adjust_e_for_mass(ev.met(),0);
+  _sums.set_met (ev.met());
+  _sums.masses (_masses);
 
   // Find the unfit top mass as the average of the two sides.
-  double umtlep = Top_Decaykin::lept (ev) . m();
+  double umtlep = _masses.lept;
   utmass = (umthad + umtlep) / 2;
 
   // Trace, if requested.
   if (_args.print_event_flag()) {
-    cout << "TopGluon_Fit::fit_one_perm() : Before fit:\n";
+    cout << H::trace_name () << "::fit_one_perm() : Before fit:\n";
     Top_Decaykin::dump_ev (cout, ev);
   }
 
   // Maybe reject this event.
-  if (_hadw_mass > 0 && test_for_bad_masses (ev, _args, umwhad,
+  if (_hadw_mass > 0 && test_for_bad_masses (_sums, _args, umwhad,
                                              umthad, umtlep))
   {
-    cout << "TopGluon_Fit: bad mass comb.\n";
-    return -999;
+    cout << H::trace_name () << ": bad mass comb.\n";
+    return false;
   }
 
+  return true;
+}
+
+
+template <class H>
+double Hypothesis_Fit<H>::constrain_one_perm (Lepjets_Event& ev,
+                                         double& mt,
+                                         double& sigmt,
+                                         Column_Vector& pullx,
+                                         Column_Vector& pully)
+//
+// Purpose: Do the constrained fit of a jet permutation set up by
+//          prepare_one_perm.
+//
+// Inputs:
+//   ev -          The event to fit, as returned by prepare_one_perm.
+//
+// Outputs:
+//   ev-           The event after the fit.
+//   mt -          Top mass after fitting.
+//   sigmt -       Top mass uncertainty after fitting.
+//   pullx -       Vector of pull quantities for well-measured variables.
+//   pully -       Vector of pull quantities for poorly-measured variables.
+//
+// Returns:
+//   The fit chisq, or < 0 if the fit didn't converge.
+//
+{
   // Do the fit.
   double chisq = _constrainer.constrain (ev, mt, sigmt, pullx, pully);
 
   // Trace, if requested.
   if (_args.print_event_flag()) {
-    cout << "TopGluon_Fit::fit_one_perm() : After fit:\n";
+    cout << H::trace_name () << "::fit_one_perm() : After fit:\n";
     cout << "chisq: " << chisq << " mt: " << mt << " ";
     Top_Decaykin::dump_ev (cout, ev);
   }
@@ -496,7 +636,8 @@ double TopGluon_Fit::fit_one_perm (Lepjets_Event& ev,
 }
 
 
-Fit_Results TopGluon_Fit::fit (const Lepjets_Event& ev)
+template <class H>
+Fit_Results Hypothesis_Fit<H>::fit (const Lepjets_Event& ev)
 //
 // Purpose: Fit all jet permutations for EV.
 //
@@ -510,18 +651,11 @@ Fit_Results TopGluon_Fit::fit (const Lepjets_Event& ev)
   // Make a new Fit_Results object.
   Fit_Results res (_args.nkeep(), n_lists);
 
-  // Set up the vector of jet types.
+  // Set up the vector of jet types: the slots of the hypothesis,
+  // the other jets ISR.
   vector<int> jet_types (ev.njets(), isr_label);
-  assert (ev.njets() >= 6);
-  jet_types[0] = lepb_label;
-  jet_types[1] = hadb_label;
-  jet_types[2] = hadw1_label;
-  jet_types[3] = hadw1_label;
-
-//  if (_args.do_TopGluon_flag() && ev.njets() >= 6) {
-    jet_types[4] = gluon1_label;
-    jet_types[5] = gluon2_label;
-//  }
+  assert (ev.njets() >= vector<int>::size_type (H::njets));
+  std::copy (H::slots, H::slots + H::njets, jet_types.begin());
 
   // Must be in sorted order.
   stable_sort (jet_types.begin(), jet_types.end());
@@ -552,7 +686,7 @@ Fit_Results TopGluon_Fit::fit (const Lepjets_Event& ev)
     double chisq;
 
     // Tracing.
-    cout << "TopGluon_Fit::fit(): Before fit: (";
+    cout << H::trace_name () << "::fit(): Before fit: (";
     for (vector<int>::size_type i=0; i < jet_types.size(); i++) {
         if (i) cout << " ";
         cout << jet_types[i];
@@ -565,7 +699,7 @@ Fit_Results TopGluon_Fit::fit (const Lepjets_Event& ev)
 
     // Print the result, if requested.
     if (_args.print_event_flag()) {
-        cout << "TopGluon_Fit::fit(): After fit:\n";
+        cout << H::trace_name () << "::fit(): After fit:\n";
         char buf[256];
         sprintf (buf, "chisq: %8.3f  mt: %6.2f pm %5.2f %c\n",
              chisq, mt, sigmt, (list_flags[noperm_list] ? '*' : ' '));
@@ -585,14 +719,15 @@ Fit_Results TopGluon_Fit::fit (const Lepjets_Event& ev)
 
 
 /**
-    @brief Output stream operator, print the content of this TopGluon_Fit object
+    @brief Output stream operator, print the content of this Hypothesis_Fit object
     to an output stream.
 
     @param s The output stream to which to write.
 
-    @param fitter The instance of TopGluon_Fit to be printed.
+    @param fitter The instance of Hypothesis_Fit to be printed.
  */
-std::ostream& operator<< (std::ostream& s, const TopGluon_Fit& fitter)
+template <class H>
+std::ostream& operator<< (std::ostream& s, const Hypothesis_Fit<H>& fitter)
 //
 // Purpose: Print the object to S.
 //
@@ -608,9 +743,33 @@ std::ostream& operator<< (std::ostream& s, const TopGluon_Fit& fitter)
 }
 
 
-const TopGluon_Fit_Args& TopGluon_Fit::args() const
+template <class H>
+const TopGluon_Fit_Args& Hypothesis_Fit<H>::args() const
 {
     return _args;
 }
 
+
+template <class H>
+const Decay_Masses& Hypothesis_Fit<H>::masses() const
+{
+    return _masses;
+}
+
+
+template <class H>
+void Hypothesis_Fit<H>::set_perf (bpkHitFitPerf* perf)
+{
+  _constrainer.set_perf (perf);
+}
+
+
+template class Hypothesis_Fit<TTbar_Hypothesis>;
+template class Hypothesis_Fit<TopGluon_Hypothesis>;
+template class Hypothesis_Fit<TTH_Hypothesis>;
+
+template std::ostream& operator<< (std::ostream&, const Hypothesis_Fit<TTbar_Hypothesis>&);
+template std::ostream& operator<< (std::ostream&, const Hypothesis_Fit<TopGluon_Hypothesis>&);
+template std::ostream& operator<< (std::ostream&, const Hypothesis_Fit<TTH_Hypothesis>&);
+
 } // namespace hitfit
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitAlloc.h"
+
+#ifdef BPKHITFIT_ALLOC_AUDIT
+
+namespace {
+
+  thread_local unsigned long t_allocs = 0;
+  thread_local unsigned long t_bytes  = 0;
+
+  void* CountedAlloc(std::size_t n)
+  {
+    t_allocs++;
+    t_bytes += n;
+    return std::malloc(n ? n : 1);
+  }
+
+} // unnamed namespace
+
+void* operator new(std::size_t n)
+{
+  void* p = CountedAlloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t n)
+{
+  void* p = CountedAlloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+  return CountedAlloc(n);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+  return CountedAlloc(n);
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+#endif
+
+#endif // BPKHITFIT_ALLOC_AUDIT
+
+namespace hitfit{
+
+  bpkHitFitAllocCount bpkHitFitAllocCount::Now()
+  {
+    bpkHitFitAllocCount c;
+#ifdef BPKHITFIT_ALLOC_AUDIT
+    c.allocs = t_allocs;
+    c.bytes  = t_bytes;
+#else
+    c.allocs = 0;
+    c.bytes  = 0;
+#endif
+    return c;
+  }
+
+  bool bpkHitFitAllocCount::Enabled()
+  {
+#ifdef BPKHITFIT_ALLOC_AUDIT
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  long bpkHitFitPeakRSS()
+  {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;   // bytes there
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+
+  long bpkHitFitCurrentRSS()
+  {
+    // Second field of statm, in pages; Linux only.
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    long size = 0, resident = 0;
+    int n = std::fscanf(f, "%ld %ld", &size, &resident);
+    std::fclose(f);
+    if (n != 2) return 0;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+  }
+
+  bpkHitFitAllocAudit::Multiplicity::Multiplicity():
+    events(0),
+    allocs(0),
+    bytes(0),
+    loop_allocs(0),
+    loop_bytes(0),
+    peak_rss_growth(0),
+    max_rss(0)
+  {
+  }
+
+  bpkHitFitAllocAudit::bpkHitFitAllocAudit():
+    last_allocs(0),
+    last_bytes(0),
+    last_loop_allocs(0),
+    last_loop_bytes(0),
+    steady_events(0),
+    steady_loop_allocs(0)
+  {
+  }
+
+  bool bpkHitFitAllocAudit::SteadyStateAllocFree() const
+  {
+    return steady_loop_allocs == 0;
+  }
+
+  void bpkHitFitAllocAudit::Merge(const bpkHitFitAllocAudit& other)
+  {
+    if (by_njets.size() < other.by_njets.size()) by_njets.resize(other.by_njets.size());
+    for (size_t n = 0 ; n != other.by_njets.size(); n++) {
+      Multiplicity& m = by_njets[n];
+      const Multiplicity& o = other.by_njets[n];
+      m.events          += o.events;
+      m.allocs          += o.allocs;
+      m.bytes           += o.bytes;
+      m.loop_allocs     += o.loop_allocs;
+      m.loop_bytes      += o.loop_bytes;
+      m.peak_rss_growth += o.peak_rss_growth;
+      m.max_rss          = std::max(m.max_rss, o.max_rss);
+    }
+    steady_events      += other.steady_events;
+    steady_loop_allocs += other.steady_loop_allocs;
+  }
+
+  std::ostream& bpkHitFitAllocAudit::dump(std::ostream& s) const
+  {
+    s << "bpkHitFitAllocAudit:";
+    if (!bpkHitFitAllocCount::Enabled()) s << " allocations not counted (no BPKHITFIT_ALLOC_AUDIT), RSS only";
+    s << "\n";
+    for (size_t n = 0 ; n != by_njets.size(); n++) {
+      const Multiplicity& m = by_njets[n];
+      if (m.events == 0) continue;
+      s << "  " << n << " jets: " << m.events << " events, "
+	<< double(m.allocs) / m.events << " allocs " << double(m.bytes) / m.events << " bytes/event, loop "
+	<< double(m.loop_allocs) / m.events << " allocs " << double(m.loop_bytes) / m.events << " bytes/event"
+	<< ", peak RSS +" << m.peak_rss_growth << " kB, max RSS " << m.max_rss << " kB\n";
+    }
+    s << "  steady state: " << steady_events << " events, " << steady_loop_allocs << " loop allocs\n";
+    return s;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,87 @@
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitBTag.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitCache.h"
+
+namespace hitfit{
+
+  namespace {
+
+    // Above any number of b slots.
+    const int MAX_TAGS = 32;
+
+    template <class T>
+    uint64_t HashValue(uint64_t h, const T& x)
+    {
+      return bpkHitFitCache::Hash(&x, sizeof(x), h);
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitBTagPolicy::bpkHitFitBTagPolicy(Tagger tagger,
+					   double threshold,
+					   Count  count,
+					   int    ntags,
+					   bool   gluon_veto):
+    _tagger(tagger),
+    _threshold(threshold),
+    _count(count),
+    _ntags(ntags),
+    _gluonVeto(gluon_veto)
+  {
+  }
+
+  double bpkHitFitBTagPolicy::Threshold(WorkingPoint wp)
+  {
+    switch (wp) {
+    case CSVL: return 0.244;
+    case CSVM: return 0.679;
+    case CSVT: return 0.898;
+    }
+    return 0.679;
+  }
+
+  bool bpkHitFitBTagPolicy::IsTagged(const bpkHitFitJet& jet) const
+  {
+    if (_tagger == TAG_DISCRIMINANT) return jet.BTagDiscr > _threshold;
+    return jet.isBTag;
+  }
+
+  bpkHitFitBTagMask bpkHitFitBTagPolicy::Compile(const std::vector<bpkHitFitJet>& jets) const
+  {
+    bpkHitFitBTagMask m;
+    m.tagged = 0;
+    int ntagged = 0;
+    for (size_t j = 0 ; j != jets.size() && j != 32; j++) {
+      if (!IsTagged(jets[j])) continue;
+      m.tagged |= 1u << j;
+      ntagged++;
+    }
+    m.veto = _gluonVeto ? m.tagged : 0;
+
+    switch (_count) {
+    case COUNT_AT_LEAST:
+      m.min_tags = _ntags;
+      m.max_tags = MAX_TAGS;
+      break;
+    case COUNT_EXACTLY:
+      m.min_tags = _ntags;
+      m.max_tags = _ntags;
+      break;
+    default:
+      m.min_tags = ntagged > 1 ? 2 : 1;
+      m.max_tags = MAX_TAGS;
+      break;
+    }
+    return m;
+  }
+
+  uint64_t bpkHitFitBTagPolicy::Hash(uint64_t h) const
+  {
+    h = HashValue(h,int(_tagger));
+    if (_tagger == TAG_DISCRIMINANT) h = HashValue(h,_threshold);
+    h = HashValue(h,int(_count));
+    if (_count != COUNT_DEFAULT) h = HashValue(h,_ntags);
+    h = HashValue(h,_gluonVeto);
+    return h;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitBatch.h"
+
+namespace hitfit{
+
+  bpkHitFitBatchInput::bpkHitFitBatchInput():
+    nevents(0),
+    runnum(0),
+    evnum(0),
+    lep_offsets(0),
+    lep_px(0),
+    lep_py(0),
+    lep_pz(0),
+    lep_e(0),
+    lep_eta(0),
+    lep_type(0),
+    jet_offsets(0),
+    jet_px(0),
+    jet_py(0),
+    jet_pz(0),
+    jet_e(0),
+    jet_eta(0),
+    jet_pt(0),
+    jet_ptcorr_l7b(0),
+    jet_ptcorr_l7uds(0),
+    jet_ptcorr_l3(0),
+    jet_btag(0),
+    jet_btag_discr(0),
+    met_x(0),
+    met_y(0),
+    met(0)
+  {
+  }
+
+  bpkHitFitBatch::bpkHitFitBatch(const bpkRunHitFit& fitter, int nthreads):
+    _fitters(nthreads > 0 ? nthreads : 1, fitter),
+    _inputs(_fitters.size()),
+    _input(0),
+    _useObjRes(false),
+    _next_event(0),
+    _failed(false)
+  {
+  }
+
+  long bpkHitFitBatch::Fit(const bpkHitFitBatchInput& input, bool useObjRes)
+  {
+    _input     = &input;
+    _useObjRes = useObjRes;
+    if (long(_results.size()) < input.nevents) _results.resize(input.nevents);
+    _best.assign(input.nevents, -1);
+    _next_event = 0;
+    _failed = false;
+
+    size_t nthreads = std::min<long>(_fitters.size(), input.nevents);
+    if (nthreads <= 1) {
+      Worker(0);
+    } else {
+      std::vector<std::thread> threads;
+      for (size_t i = 0 ; i != nthreads; i++) {
+	threads.push_back(std::thread(&bpkHitFitBatch::Worker, this, int(i)));
+      }
+      for (size_t i = 0 ; i != threads.size(); i++) {
+	threads[i].join();
+      }
+    }
+    _input = 0;
+    if (_failed) return -1;
+
+    long nresults = 0;
+    for (long i = 0 ; i != input.nevents; i++) {
+      nresults += _results[i].size();
+    }
+    return nresults;
+  }
+
+  void bpkHitFitBatch::Worker(int worker)
+  {
+    // An exception leaving a std::thread terminates the process, and
+    // with it Python; it is recorded instead, and the other workers
+    // stop at their next event.
+    long i = -1;
+    try {
+      for (;;) {
+	i = _next_event++;
+	if (i >= _input->nevents || _failed) break;
+	FitOne(worker, i);
+      }
+    } catch (std::exception& e) {
+      std::cerr << "bpkHitFitBatch: event " << i << ": " << e.what() << std::endl;
+      _failed = true;
+    } catch (...) {
+      std::cerr << "bpkHitFitBatch: event " << i << ": unknown exception" << std::endl;
+      _failed = true;
+    }
+  }
+
+  void bpkHitFitBatch::FitOne(int worker, long i)
+  {
+    const bpkHitFitBatchInput& in = *_input;
+    bpkHitFitInput& input = _inputs[worker];
+    input.clear();
+    input.runnum = in.runnum ? in.runnum[i] : 0;
+    input.evnum  = in.evnum  ? in.evnum[i]  : 0;
+    input.entry  = i;
+
+    for (long k = in.lep_offsets[i] ; k != in.lep_offsets[i+1]; k++) {
+      bpkHitFitLepton lep;
+      lep.Px         = in.lep_px[k];
+      lep.Py         = in.lep_py[k];
+      lep.Pz         = in.lep_pz[k];
+      lep.Energy     = in.lep_e[k];
+      lep.Eta        = in.lep_eta[k];
+      lep.LeptonType = in.lep_type[k];
+      input.leptons.push_back(lep);
+    }
+
+    for (long k = in.jet_offsets[i] ; k != in.jet_offsets[i+1]; k++) {
+      bpkHitFitJet jet;
+      jet.Px          = in.jet_px[k];
+      jet.Py          = in.jet_py[k];
+      jet.Pz          = in.jet_pz[k];
+      jet.Energy      = in.jet_e[k];
+      jet.Eta         = in.jet_eta[k];
+      jet.Pt          = in.jet_pt[k];
+      jet.PtCorrL7b   = in.jet_ptcorr_l7b[k];
+      jet.PtCorrL7uds = in.jet_ptcorr_l7uds[k];
+      jet.PtCorrL3    = in.jet_ptcorr_l3[k];
+      jet.BTagDiscr   = in.jet_btag_discr ? in.jet_btag_discr[k] : -999;
+      jet.isBTag      = in.jet_btag[k] != 0;
+      input.jets.push_back(jet);
+    }
+
+    input.PFMETx = in.met_x[i];
+    input.PFMETy = in.met_y[i];
+    input.PFMET  = in.met[i];
+
+    bpkRunHitFit& fitter = _fitters[worker];
+    fitter.FitEvent(input, _useObjRes);
+
+    // Read the compact results, no Fit_Result is built.
+    Scratch_Vector<bpkHitFitBatchRow>& rows = _results[i];
+    rows.reset();
+    for (size_t j = 0 ; j != fitter.NumFitResults(); j++) {
+      const Compact_Fit_Result& r = fitter.GetCompactResult(j);
+      bpkHitFitBatchRow& row = rows.extend();
+      row.code   = fitter.GetPermutationCode(j);
+      row.chi2   = r.chisq();
+      row.mt     = r.mt();
+      row.sigmt  = r.sigmt();
+      row.umwhad = r.umwhad();
+      row.utmass = r.utmass();
+    }
+    _best[i] = fitter.GetBestFit();
+  }
+
+  long bpkHitFitBatch::NumEvents() const
+  {
+    return _best.size();
+  }
+
+  const Scratch_Vector<bpkHitFitBatchRow>& bpkHitFitBatch::GetResults(long i) const
+  {
+    return _results[i];
+  }
+
+  int bpkHitFitBatch::GetBest(long i) const
+  {
+    return _best[i];
+  }
+
+} // namespace hitfit
+
+using namespace hitfit;
+
+void* bpkHitFitBatch_Create(const char* default_file,
+			    double      lepw_mass,
+			    double      hadw_mass,
+			    double      top_mass,
+			    int         nu_solution,
+			    int         nthreads,
+			    const char* electron_resolution,
+			    const char* muon_resolution,
+			    const char* udsc_resolution,
+			    const char* b_resolution,
+			    const char* met_resolution)
+{
+  // Exceptions must not cross into Python.
+  try {
+    LeptonTranslator lep(electron_resolution ? electron_resolution : "",
+			 muon_resolution     ? muon_resolution     : "");
+    JetTranslator    jet(udsc_resolution ? udsc_resolution : "",
+			 b_resolution    ? b_resolution    : "");
+    METTranslator    met = (met_resolution && *met_resolution) ?
+      METTranslator(met_resolution) : METTranslator();
+    bpkRunHitFit fitter(lep, jet, met, default_file, lepw_mass, hadw_mass, top_mass, nu_solution);
+    return new bpkHitFitBatch(fitter, nthreads);
+  } catch (std::exception& e) {
+    std::cerr << "bpkHitFitBatch_Create: " << e.what() << std::endl;
+    return 0;
+  }
+}
+
+void bpkHitFitBatch_Destroy(void* handle)
+{
+  delete static_cast<bpkHitFitBatch*>(handle);
+}
+
+long bpkHitFitBatch_Fit(void* handle, const bpkHitFitBatchInput* input, int useObjRes)
+{
+  if (!handle || !input) return -1;
+  try {
+    return static_cast<bpkHitFitBatch*>(handle)->Fit(*input, useObjRes != 0);
+  } catch (std::exception& e) {
+    std::cerr << "bpkHitFitBatch_Fit: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
+void bpkHitFitBatch_Get(void*   handle,
+			long*   offsets,
+			int*    best,
+			int*    code,
+			double* chi2,
+			double* mt,
+			double* sigmt,
+			double* umwhad,
+			double* utmass)
+{
+  if (!handle) return;
+  const bpkHitFitBatch& batch = *static_cast<bpkHitFitBatch*>(handle);
+  long k = 0;
+  for (long i = 0 ; i != batch.NumEvents(); i++) {
+    if (offsets) offsets[i] = k;
+    if (best)    best[i]    = batch.GetBest(i);
+    const Scratch_Vector<bpkHitFitBatchRow>& rows = batch.GetResults(i);
+    for (size_t j = 0 ; j != rows.size(); j++, k++) {
+      const bpkHitFitBatchRow& row = rows[j];
+      if (code)   code[k]   = row.code;
+      if (chi2)   chi2[k]   = row.chi2;
+      if (mt)     mt[k]     = row.mt;
+      if (sigmt)  sigmt[k]  = row.sigmt;
+      if (umwhad) umwhad[k] = row.umwhad;
+      if (utmass) utmass[k] = row.utmass;
+    }
+  }
+  if (offsets) offsets[batch.NumEvents()] = k;
+}
@@ -0,0 +1,288 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitCache.h"
+
+namespace hitfit{
+
+  namespace {
+
+    // File header, including the format version.
+    const char     FILE_MAGIC[8] = { 'B','P','K','H','F','C','\0','\1' };
+    const uint32_t RECORD_MAGIC  = 0x52464842;  // "BHFR"
+
+    struct RecordHeader {
+      uint32_t magic;
+      uint32_t size;
+      int32_t  runnum;
+      int32_t  evnum;
+      uint64_t input_hash;
+      uint64_t config_hash;
+      uint64_t checksum;    // of the payload
+    };
+
+    bool WriteAll(int fd, const void* data, size_t n, uint64_t offset)
+    {
+      const char* p = static_cast<const char*>(data);
+      while (n > 0) {
+	ssize_t w = pwrite(fd, p, n, offset);
+	if (w < 0) {
+	  if (errno == EINTR) continue;
+	  return false;
+	}
+	p      += w;
+	n      -= w;
+	offset += w;
+      }
+      return true;
+    }
+
+    // Exclusive lock of the file while in scope, for the processes
+    // sharing it; the threads of one process are kept apart by the
+    // mutex of the cache.
+    class FileLock {
+    public:
+      explicit FileLock(int fd) : _fd(fd)
+      {
+	while (flock(_fd, LOCK_EX) != 0 && errno == EINTR) {}
+      }
+      ~FileLock() { flock(_fd, LOCK_UN); }
+    private:
+      int _fd;
+    };
+
+  } // unnamed namespace
+
+  bpkHitFitCacheKey::bpkHitFitCacheKey():
+    runnum(0),
+    evnum(0),
+    input_hash(0),
+    config_hash(0)
+  {
+  }
+
+  bpkHitFitCacheKey::bpkHitFitCacheKey(int runnum_, int evnum_, uint64_t input_hash_, uint64_t config_hash_):
+    runnum(runnum_),
+    evnum(evnum_),
+    input_hash(input_hash_),
+    config_hash(config_hash_)
+  {
+  }
+
+  bool bpkHitFitCacheKey::operator==(const bpkHitFitCacheKey& other) const
+  {
+    return runnum == other.runnum && evnum == other.evnum &&
+      input_hash == other.input_hash && config_hash == other.config_hash;
+  }
+
+  size_t bpkHitFitCache::KeyHash::operator()(const bpkHitFitCacheKey& key) const
+  {
+    uint64_t h = Hash(&key.runnum, sizeof(key.runnum));
+    h = Hash(&key.evnum, sizeof(key.evnum), h);
+    return h ^ key.input_hash ^ (key.config_hash * 31);
+  }
+
+  bpkHitFitCache::bpkHitFitCache(const std::string& path, bool read_only):
+    _path(path),
+    _read_only(read_only),
+    _fd(-1),
+    _map(0),
+    _mapped(0),
+    _end(0),
+    _truncated(0)
+  {
+    _fd = read_only ? open(path.c_str(), O_RDONLY) : open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) {
+      std::cerr << "bpkHitFitCache: cannot open " << path << ": " << strerror(errno) << std::endl;
+      return;
+    }
+
+    // A writer holds the file lock while it sets the file up, so that
+    // the scan cannot cut off a record another process is writing.
+    bool ok;
+    if (read_only) {
+      ok = Open();
+    } else {
+      FileLock lock(_fd);
+      ok = Open();
+    }
+    if (!ok) {
+      Unmap();
+      close(_fd);
+      _fd = -1;
+    }
+  }
+
+  bool bpkHitFitCache::Open()
+  {
+    struct stat st;
+    if (fstat(_fd, &st) != 0) {
+      std::cerr << "bpkHitFitCache: cannot stat " << _path << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    if (st.st_size == 0 && !_read_only) {
+      if (!WriteAll(_fd, FILE_MAGIC, sizeof(FILE_MAGIC), 0)) {
+	std::cerr << "bpkHitFitCache: cannot write " << _path << ": " << strerror(errno) << std::endl;
+	return false;
+      }
+      st.st_size = sizeof(FILE_MAGIC);
+    }
+
+    if (!Map(st.st_size) || memcmp(_map, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+      std::cerr << "bpkHitFitCache: " << _path << " is not a cache file of this version" << std::endl;
+      return false;
+    }
+
+    Scan();
+    return true;
+  }
+
+  bpkHitFitCache::~bpkHitFitCache()
+  {
+    Flush();
+    Unmap();
+    if (_fd >= 0) close(_fd);
+  }
+
+  bool bpkHitFitCache::IsOpen() const
+  {
+    return _fd >= 0;
+  }
+
+  bool bpkHitFitCache::Map(uint64_t size)
+  {
+    Unmap();
+    if (size == 0) return false;
+    void* p = mmap(0, size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) return false;
+    _map    = static_cast<const char*>(p);
+    _mapped = size;
+    return true;
+  }
+
+  void bpkHitFitCache::Unmap()
+  {
+    if (_map) munmap(const_cast<char*>(_map), _mapped);
+    _map    = 0;
+    _mapped = 0;
+  }
+
+  void bpkHitFitCache::Scan()
+  {
+    uint64_t pos = sizeof(FILE_MAGIC);
+    while (pos + sizeof(RecordHeader) <= _mapped) {
+      RecordHeader h;
+      memcpy(&h, _map + pos, sizeof(h));
+      uint64_t payload = pos + sizeof(h);
+      if (h.magic != RECORD_MAGIC || payload + h.size > _mapped) break;
+      if (Hash(_map + payload, h.size) != h.checksum) break;
+
+      Location loc;
+      loc.offset = payload;
+      loc.size   = h.size;
+      _index[bpkHitFitCacheKey(h.runnum, h.evnum, h.input_hash, h.config_hash)] = loc;
+      pos = payload + h.size;
+    }
+    _end = pos;
+
+    // Cut off a damaged end, so that new records follow the last good one.
+    if (_end < _mapped) {
+      _truncated = _mapped - _end;
+      std::cerr << "bpkHitFitCache: " << _path << ": ignoring " << _truncated
+		<< " damaged bytes at the end" << std::endl;
+      if (!_read_only && ftruncate(_fd, _end) != 0) {
+	std::cerr << "bpkHitFitCache: cannot truncate " << _path << ": " << strerror(errno) << std::endl;
+	_read_only = true;
+      }
+    }
+  }
+
+  bool bpkHitFitCache::Find(const bpkHitFitCacheKey& key, std::vector<char>& payload)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd < 0) return false;
+
+    std::unordered_map<bpkHitFitCacheKey, Location, KeyHash>::const_iterator it = _index.find(key);
+    if (it == _index.end()) return false;
+
+    // Records stored since the file was mapped need a larger mapping.
+    const Location& loc = it->second;
+    if (loc.offset + loc.size > _mapped && !Map(_end)) return false;
+
+    payload.assign(_map + loc.offset, _map + loc.offset + loc.size);
+    return true;
+  }
+
+  void bpkHitFitCache::Store(const bpkHitFitCacheKey& key, const std::vector<char>& payload)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd < 0 || _read_only) return;
+
+    RecordHeader h;
+    h.magic       = RECORD_MAGIC;
+    h.size        = payload.size();
+    h.runnum      = key.runnum;
+    h.evnum       = key.evnum;
+    h.input_hash  = key.input_hash;
+    h.config_hash = key.config_hash;
+    h.checksum    = Hash(payload.empty() ? 0 : &payload[0], payload.size());
+
+    // Other processes may have appended to the file since we last
+    // wrote; the record goes after theirs.  Their records are not
+    // indexed here.
+    FileLock file_lock(_fd);
+    struct stat st;
+    if (fstat(_fd, &st) == 0 && uint64_t(st.st_size) > _end) _end = st.st_size;
+
+    if (!WriteAll(_fd, &h, sizeof(h), _end) ||
+	(!payload.empty() && !WriteAll(_fd, &payload[0], payload.size(), _end + sizeof(h)))) {
+      // A partial record is cut off when the file is next opened.
+      std::cerr << "bpkHitFitCache: cannot write " << _path << ": " << strerror(errno)
+		<< ", no further results are stored" << std::endl;
+      _read_only = true;
+      return;
+    }
+
+    Location loc;
+    loc.offset = _end + sizeof(h);
+    loc.size   = h.size;
+    _index[key] = loc;
+    _end = loc.offset + loc.size;
+  }
+
+  void bpkHitFitCache::Flush()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd >= 0 && !_read_only) fdatasync(_fd);
+  }
+
+  size_t bpkHitFitCache::NumKeys() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _index.size();
+  }
+
+  uint64_t bpkHitFitCache::TruncatedBytes() const
+  {
+    return _truncated;
+  }
+
+  uint64_t bpkHitFitCache::Hash(const void* data, size_t n, uint64_t h)
+  {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0 ; i != n; i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+} // namespace hitfit
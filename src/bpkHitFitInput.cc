@@ -0,0 +1,74 @@
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+#include "MyAna/bprimeKit/interface/format.h"
+
+namespace hitfit{
+
+  bpkHitFitInput::bpkHitFitInput():
+    runnum(0),
+    evnum(0),
+    entry(-1),
+    PFMETx(0.),
+    PFMETy(0.),
+    PFMET(0.)
+  {
+  }
+
+  void bpkHitFitInput::clear()
+  {
+    runnum = 0;
+    evnum  = 0;
+    entry  = -1;
+    leptons.clear();
+    jets.clear();
+    PFMETx = 0.;
+    PFMETy = 0.;
+    PFMET  = 0.;
+  }
+
+  void bpkHitFitInput::AddLepton(const LepInfoBranches& lep, const int index)
+  {
+    leptons.push_back(MakeLepton(lep,index));
+  }
+
+  void bpkHitFitInput::AddJet(const JetInfoBranches& jet, const int index, bool isBTag)
+  {
+    jets.push_back(MakeJet(jet,index,isBTag));
+  }
+
+  void bpkHitFitInput::SetMet(const EvtInfoBranches& evt)
+  {
+    PFMETx = evt.PFMETx;
+    PFMETy = evt.PFMETy;
+    PFMET  = evt.PFMET;
+  }
+
+  bpkHitFitLepton bpkHitFitInput::MakeLepton(const LepInfoBranches& lep, const int index)
+  {
+    bpkHitFitLepton l;
+    l.Px         = lep.Px[index];
+    l.Py         = lep.Py[index];
+    l.Pz         = lep.Pz[index];
+    l.Energy     = lep.Energy[index];
+    l.Eta        = lep.Eta[index];
+    l.LeptonType = lep.LeptonType[index];
+    return l;
+  }
+
+  bpkHitFitJet bpkHitFitInput::MakeJet(const JetInfoBranches& jet, const int index, bool isBTag)
+  {
+    bpkHitFitJet j;
+    j.Px          = jet.Px[index];
+    j.Py          = jet.Py[index];
+    j.Pz          = jet.Pz[index];
+    j.Energy      = jet.Energy[index];
+    j.Eta         = jet.Eta[index];
+    j.Pt          = jet.Pt[index];
+    j.PtCorrL7b   = jet.PtCorrL7b[index];
+    j.PtCorrL7uds = jet.PtCorrL7uds[index];
+    j.PtCorrL3    = jet.PtCorrL3[index];
+    j.BTagDiscr   = jet.CombinedSVBJetTags[index];
+    j.isBTag      = isBTag;
+    return j;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitObservables.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+
+namespace hitfit{
+
+  bpkHitFitHistogram::bpkHitFitHistogram(int nbins, double lo, double hi):
+    _nbins(nbins > 0 ? nbins : 1),
+    _lo(lo),
+    _hi(hi > lo ? hi : lo + 1.),
+    _scale(_nbins / (_hi - _lo)),
+    _bins(_nbins + 2, 0.)
+  {
+    Reset();
+  }
+
+  void bpkHitFitHistogram::Fill(double x)
+  {
+    if (std::isnan(x)) return;
+
+    int bin;
+    if (x < _lo)        bin = 0;
+    else if (x >= _hi)  bin = _nbins + 1;
+    else                bin = std::min<int>(int((x - _lo) * _scale), _nbins - 1) + 1;
+    _bins[bin] += 1.;
+
+    _n++;
+    _sum  += x;
+    _sum2 += x*x;
+    if (x < _min) _min = x;
+    if (x > _max) _max = x;
+  }
+
+  void bpkHitFitHistogram::Merge(const bpkHitFitHistogram& other)
+  {
+    for (size_t i = 0 ; i != _bins.size() && i != other._bins.size(); i++) {
+      _bins[i] += other._bins[i];
+    }
+    _n    += other._n;
+    _sum  += other._sum;
+    _sum2 += other._sum2;
+    _min   = std::min(_min, other._min);
+    _max   = std::max(_max, other._max);
+  }
+
+  void bpkHitFitHistogram::Reset()
+  {
+    std::fill(_bins.begin(), _bins.end(), 0.);
+    _n    = 0;
+    _sum  = 0.;
+    _sum2 = 0.;
+    _min  = std::numeric_limits<double>::max();
+    _max  = -std::numeric_limits<double>::max();
+  }
+
+  int bpkHitFitHistogram::NumBins() const
+  {
+    return _nbins;
+  }
+
+  double bpkHitFitHistogram::Low() const
+  {
+    return _lo;
+  }
+
+  double bpkHitFitHistogram::High() const
+  {
+    return _hi;
+  }
+
+  double bpkHitFitHistogram::BinContent(int bin) const
+  {
+    return _bins[bin];
+  }
+
+  double bpkHitFitHistogram::BinLowEdge(int bin) const
+  {
+    return _lo + (bin - 1) / _scale;
+  }
+
+  unsigned long bpkHitFitHistogram::Entries() const
+  {
+    return _n;
+  }
+
+  double bpkHitFitHistogram::Mean() const
+  {
+    return _n > 0 ? _sum / _n : 0.;
+  }
+
+  double bpkHitFitHistogram::RMS() const
+  {
+    if (_n == 0) return 0.;
+    double mean = Mean();
+    return std::sqrt(std::max(0., _sum2 / _n - mean*mean));
+  }
+
+  double bpkHitFitHistogram::Min() const
+  {
+    return _n > 0 ? _min : 0.;
+  }
+
+  double bpkHitFitHistogram::Max() const
+  {
+    return _n > 0 ? _max : 0.;
+  }
+
+  bpkHitFitObservables::bpkHitFitObservables():
+    _nevents(0),
+    _nconverged(0)
+  {
+    SetBinning(chi2,    100,    0.,  100.);
+    SetBinning(mt,      200,    0., 2000.);
+    SetBinning(sigmt,   100,    0.,  200.);
+    SetBinning(mtg_lep, 200,    0., 2000.);
+    SetBinning(mtg_had, 200,    0., 2000.);
+    SetBinning(pullx,   100,   -5.,    5.);
+    SetBinning(pully,   100,   -5.,    5.);
+  }
+
+  void bpkHitFitObservables::SetBinning(Observable obs, int nbins, double lo, double hi)
+  {
+    _histograms[obs] = bpkHitFitHistogram(nbins, lo, hi);
+  }
+
+  void bpkHitFitObservables::Fill(const bpkRunHitFit& fitter)
+  {
+    _nevents++;
+
+    int best = fitter.GetBestFit();
+    if (best < 0) return;
+    _nconverged++;
+
+    const Compact_Fit_Result& r = fitter.GetCompactResult(best);
+
+    // The t+g masses from the fitted momenta, as in bpkHitFitWriter.
+    const Compact_Event& ev = r.ev();
+    Fourvec lep = ev.met();
+    if (ev.nleps() > 0) lep += ev.p(0);
+    Fourvec had;
+    for (size_t i = ev.nleps() ; i != ev.nobjs(); i++) {
+      switch (ev.type[i]) {
+      case lepb_label:
+      case gluon1_label: lep += ev.p(i); break;
+      case hadb_label:
+      case hadw1_label:
+      case hadw2_label:
+      case gluon2_label: had += ev.p(i); break;
+      }
+    }
+    FillBest(r.chisq(), r.mt(), r.sigmt(), lep.m(), had.m(), r.pullx(), r.pully());
+  }
+
+  void bpkHitFitObservables::Fill(const Fit_Result* best)
+  {
+    _nevents++;
+
+    if (!best) return;
+    _nconverged++;
+
+    // As above, from the full event.
+    const Lepjets_Event& ev = best->ev();
+    Fourvec lep = ev.met();
+    if (ev.nleps() > 0) lep += ev.lep(0).p();
+    Fourvec had;
+    for (size_t j = 0 ; j != ev.njets(); j++) {
+      switch (ev.jet(j).type()) {
+      case lepb_label:
+      case gluon1_label: lep += ev.jet(j).p(); break;
+      case hadb_label:
+      case hadw1_label:
+      case hadw2_label:
+      case gluon2_label: had += ev.jet(j).p(); break;
+      }
+    }
+    FillBest(best->chisq(), best->mt(), best->sigmt(), lep.m(), had.m(), best->pullx(), best->pully());
+  }
+
+  void bpkHitFitObservables::FillBest(double chisq, double top_mass, double top_sigma,
+				      double lep_mass, double had_mass,
+				      const Column_Vector& px, const Column_Vector& py)
+  {
+    _histograms[chi2].Fill(chisq);
+    _histograms[mt].Fill(top_mass);
+    _histograms[sigmt].Fill(top_sigma);
+    _histograms[mtg_lep].Fill(lep_mass);
+    _histograms[mtg_had].Fill(had_mass);
+    for (int k = 0 ; k != px.num_row(); k++) _histograms[pullx].Fill(px[k]);
+    for (int k = 0 ; k != py.num_row(); k++) _histograms[pully].Fill(py[k]);
+  }
+
+  void bpkHitFitObservables::Merge(const bpkHitFitObservables& other)
+  {
+    for (int k = 0 ; k != n_observables; k++) {
+      _histograms[k].Merge(other._histograms[k]);
+    }
+    _nevents    += other._nevents;
+    _nconverged += other._nconverged;
+  }
+
+  void bpkHitFitObservables::Reset()
+  {
+    for (int k = 0 ; k != n_observables; k++) {
+      _histograms[k].Reset();
+    }
+    _nevents    = 0;
+    _nconverged = 0;
+  }
+
+  const bpkHitFitHistogram& bpkHitFitObservables::Histogram(Observable obs) const
+  {
+    return _histograms[obs];
+  }
+
+  unsigned long bpkHitFitObservables::NumEvents() const
+  {
+    return _nevents;
+  }
+
+  unsigned long bpkHitFitObservables::NumConverged() const
+  {
+    return _nconverged;
+  }
+
+  const char* bpkHitFitObservables::Name(Observable obs)
+  {
+    static const char* const names[n_observables] = {
+      "chi2", "mt", "sigmt", "mtg_lep", "mtg_had", "pullx", "pully"
+    };
+    return names[obs];
+  }
+
+  std::ostream& bpkHitFitObservables::dump(std::ostream& s) const
+  {
+    s << "bpkHitFitObservables: " << _nevents << " events, "
+      << _nconverged << " with a converged fit\n";
+    for (int k = 0 ; k != n_observables; k++) {
+      const bpkHitFitHistogram& h = _histograms[k];
+      s << "  " << Name(Observable(k)) << ": " << h.Entries() << " entries, mean "
+	<< h.Mean() << " rms " << h.RMS() << " min " << h.Min() << " max " << h.Max()
+	<< ", under/overflow " << h.BinContent(0) << "/" << h.BinContent(h.NumBins() + 1) << "\n";
+    }
+    return s;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,264 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitAlloc.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPerf.h"
+
+namespace hitfit{
+
+  namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+#ifdef __linux__
+    const uint64_t COUNTER_CONFIG[bpkHitFitPerfCounters::n_counters] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    int OpenCounter(uint64_t config, int group)
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.config         = config;
+      attr.disabled       = group < 0;   // the group starts with its leader
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP |
+	PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    }
+#endif
+
+    double Ratio(double x, double n)
+    {
+      return n > 0 ? x / n : 0.;
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitPerfCounters::bpkHitFitPerfCounters():
+    _tried(false)
+  {
+    for (int c = 0 ; c != n_counters; c++) _fd[c] = -1;
+  }
+
+  bpkHitFitPerfCounters::bpkHitFitPerfCounters(const bpkHitFitPerfCounters&):
+    _tried(false)
+  {
+    for (int c = 0 ; c != n_counters; c++) _fd[c] = -1;
+  }
+
+  bpkHitFitPerfCounters& bpkHitFitPerfCounters::operator=(const bpkHitFitPerfCounters&)
+  {
+    return *this;
+  }
+
+  bpkHitFitPerfCounters::~bpkHitFitPerfCounters()
+  {
+    Close();
+  }
+
+  bool bpkHitFitPerfCounters::Open()
+  {
+    if (_tried) return Available();
+    _tried = true;
+#ifdef __linux__
+    for (int c = 0 ; c != n_counters; c++) {
+      _fd[c] = OpenCounter(COUNTER_CONFIG[c], c == 0 ? -1 : _fd[0]);
+      if (_fd[c] < 0) {
+	Close();
+	return false;
+      }
+    }
+    ioctl(_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void bpkHitFitPerfCounters::Close()
+  {
+#ifdef __linux__
+    for (int c = n_counters ; c != 0; c--) {
+      if (_fd[c-1] >= 0) close(_fd[c-1]);
+      _fd[c-1] = -1;
+    }
+#endif
+  }
+
+  bool bpkHitFitPerfCounters::Available() const
+  {
+    return _fd[0] >= 0;
+  }
+
+  void bpkHitFitPerfCounters::Read(uint64_t values[n_counters]) const
+  {
+    for (int c = 0 ; c != n_counters; c++) values[c] = 0;
+#ifdef __linux__
+    if (!Available()) return;
+    // nr, time enabled, time running, one value per counter
+    uint64_t buf[3 + n_counters];
+    if (read(_fd[0], buf, sizeof(buf)) != ssize_t(sizeof(buf)) || buf[0] != uint64_t(n_counters)) return;
+    const double scale = (buf[2] > 0 && buf[2] < buf[1]) ? double(buf[1]) / buf[2] : 1.;
+    for (int c = 0 ; c != n_counters; c++) {
+      values[c] = scale != 1. ? uint64_t(buf[3 + c] * scale) : buf[3 + c];
+    }
+#endif
+  }
+
+  const char* bpkHitFitPerfCounters::Name(Counter c)
+  {
+    static const char* const names[n_counters] = {
+      "cycles", "instructions", "cache_misses", "branch_misses"
+    };
+    return names[c];
+  }
+
+  bpkHitFitPerf::bpkHitFitPerf():
+    _available(false)
+  {
+    Reset();
+  }
+
+  void bpkHitFitPerf::Take(Sample& s)
+  {
+    if (_counters.Open()) _available = true;
+    _counters.Read(s.counts);
+    s.seconds = std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+    const bpkHitFitAllocCount a = bpkHitFitAllocCount::Now();
+    s.allocs      = a.allocs;
+    s.alloc_bytes = a.bytes;
+  }
+
+  void bpkHitFitPerf::Add(Stage stage, const Sample& from, const Sample& to, unsigned long calls)
+  {
+    _calls[stage]   += calls;
+    _seconds[stage] += to.seconds - from.seconds;
+    for (int c = 0 ; c != bpkHitFitPerfCounters::n_counters; c++) {
+      // The multiplexing scale may change between the two reads.
+      if (to.counts[c] > from.counts[c]) _counts[stage][c] += to.counts[c] - from.counts[c];
+    }
+    _allocs[stage]     += to.allocs - from.allocs;
+    _allocBytes[stage] += to.alloc_bytes - from.alloc_bytes;
+  }
+
+  void bpkHitFitPerf::CountEvent()
+  {
+    _nevents++;
+  }
+
+  void bpkHitFitPerf::Merge(const bpkHitFitPerf& other)
+  {
+    _available = _available || other._available;
+    _nevents  += other._nevents;
+    for (int k = 0 ; k != n_stages; k++) {
+      _calls[k]   += other._calls[k];
+      _seconds[k] += other._seconds[k];
+      for (int c = 0 ; c != bpkHitFitPerfCounters::n_counters; c++) {
+	_counts[k][c] += other._counts[k][c];
+      }
+      _allocs[k]     += other._allocs[k];
+      _allocBytes[k] += other._allocBytes[k];
+    }
+  }
+
+  void bpkHitFitPerf::Reset()
+  {
+    _nevents = 0;
+    for (int k = 0 ; k != n_stages; k++) {
+      _calls[k]   = 0;
+      _seconds[k] = 0.;
+      for (int c = 0 ; c != bpkHitFitPerfCounters::n_counters; c++) _counts[k][c] = 0;
+      _allocs[k]     = 0;
+      _allocBytes[k] = 0;
+    }
+  }
+
+  bool bpkHitFitPerf::Available() const
+  {
+    return _available;
+  }
+
+  unsigned long bpkHitFitPerf::NumEvents() const
+  {
+    return _nevents;
+  }
+
+  unsigned long bpkHitFitPerf::NumCalls(Stage stage) const
+  {
+    return _calls[stage];
+  }
+
+  double bpkHitFitPerf::Seconds(Stage stage) const
+  {
+    return _seconds[stage];
+  }
+
+  uint64_t bpkHitFitPerf::Count(Stage stage, bpkHitFitPerfCounters::Counter c) const
+  {
+    return _counts[stage][c];
+  }
+
+  unsigned long bpkHitFitPerf::Allocs(Stage stage) const
+  {
+    return _allocs[stage];
+  }
+
+  unsigned long bpkHitFitPerf::AllocBytes(Stage stage) const
+  {
+    return _allocBytes[stage];
+  }
+
+  const char* bpkHitFitPerf::Name(Stage stage)
+  {
+    static const char* const names[n_stages] = {
+      "translation", "neutrino_solve", "import_export", "constrainer"
+    };
+    return names[stage];
+  }
+
+  std::ostream& bpkHitFitPerf::dump(std::ostream& s) const
+  {
+    const double nfits = _calls[constrainer];
+    s << "bpkHitFitPerf: " << _nevents << " events, " << _calls[constrainer] << " fits";
+    if (!_available) s << ", hardware counters not available, time only";
+    s << "\n";
+    for (int k = 0 ; k != n_stages; k++) {
+      s << "  " << Name(Stage(k)) << ": " << _calls[k] << " calls, "
+	<< _seconds[k] << " s, " << Ratio(1e6 * _seconds[k], _nevents) << " us/event, "
+	<< Ratio(1e6 * _seconds[k], nfits) << " us/fit\n";
+      if (bpkHitFitAllocCount::Enabled()) {
+	s << "    allocs " << Ratio(_allocs[k], _nevents) << "/event " << Ratio(_allocs[k], nfits)
+	  << "/fit, bytes " << Ratio(_allocBytes[k], _nevents) << "/event " << Ratio(_allocBytes[k], nfits) << "/fit\n";
+      }
+      if (!_available) continue;
+      s << "   ";
+      for (int c = 0 ; c != bpkHitFitPerfCounters::n_counters; c++) {
+	s << " " << bpkHitFitPerfCounters::Name(bpkHitFitPerfCounters::Counter(c)) << " "
+	  << Ratio(_counts[k][c], _nevents) << "/event " << Ratio(_counts[k][c], nfits) << "/fit";
+      }
+      const double instr = _counts[k][bpkHitFitPerfCounters::instructions];
+      s << "\n    IPC " << Ratio(instr, _counts[k][bpkHitFitPerfCounters::cycles])
+	<< ", cache misses " << Ratio(1e3 * _counts[k][bpkHitFitPerfCounters::cache_misses], instr)
+	<< "/kinstr, branch misses " << Ratio(1e3 * _counts[k][bpkHitFitPerfCounters::branch_misses], instr)
+	<< "/kinstr\n";
+    }
+    return s;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,315 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPipeline.h"
+
+namespace hitfit{
+
+  namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double Seconds(const Clock::time_point& start, const Clock::time_point& stop)
+    {
+      return std::chrono::duration<double>(stop - start).count();
+    }
+
+    template <class T>
+    bpkHitFitQueueStats QueueStats(const Bounded_Queue<T>& queue)
+    {
+      bpkHitFitQueueStats stats;
+      stats.npush          = queue.npush();
+      stats.mean_occupancy = queue.mean_occupancy();
+      stats.max_occupancy  = queue.max_occupancy();
+      stats.full_waits     = queue.full_waits();
+      stats.empty_waits    = queue.empty_waits();
+      return stats;
+    }
+
+    void DumpStage(std::ostream& s, const char* name, const bpkHitFitStageStats& stage)
+    {
+      s << name << ": " << stage.nevents << " events, busy "
+	<< stage.busy_seconds << " s of " << stage.wall_seconds << " s";
+      if (stage.busy_seconds > 0)
+	s << ", " << stage.nevents / stage.busy_seconds << " events/s busy";
+      s << "\n";
+    }
+
+    void DumpQueue(std::ostream& s, const char* name, int i, const bpkHitFitQueueStats& queue)
+    {
+      s << name << " queue " << i << ": " << queue.npush << " events, occupancy mean "
+	<< queue.mean_occupancy << " max " << queue.max_occupancy
+	<< ", full " << queue.full_waits << " empty " << queue.empty_waits << "\n";
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitOutput::bpkHitFitOutput():
+    runnum(0),
+    evnum(0),
+    entry(-1),
+    njets(0),
+    best(-1)
+  {
+  }
+
+  void bpkHitFitOutput::Assign(const bpkRunHitFit& fitter, const bpkHitFitInput& input)
+  {
+    runnum = input.runnum;
+    evnum  = input.evnum;
+    entry  = input.entry;
+    njets  = std::min<size_t>(input.jets.size(), MAX_HITFIT_JET);
+    best   = fitter.GetBestFit();
+    results.reset();
+    codes.reset();
+    for (size_t i = 0 ; i != fitter.NumFitResults(); i++) {
+      results.push_back(fitter.GetFitResult(i));
+      codes.push_back(fitter.GetPermutationCode(i));
+    }
+  }
+
+  bpkHitFitStageStats::bpkHitFitStageStats():
+    nevents(0),
+    busy_seconds(0.),
+    wall_seconds(0.)
+  {
+  }
+
+  bpkHitFitQueueStats::bpkHitFitQueueStats():
+    npush(0),
+    mean_occupancy(0.),
+    max_occupancy(0),
+    full_waits(0),
+    empty_waits(0)
+  {
+  }
+
+  std::ostream& bpkHitFitPipelineStats::dump(std::ostream& s) const
+  {
+    s << "bpkHitFitPipeline: " << write.nevents << " events in " << wall_seconds << " s";
+    if (wall_seconds > 0) s << ", " << write.nevents / wall_seconds << " events/s";
+    s << "\n";
+    DumpStage(s, "  read ", read);
+    for (size_t i = 0 ; i != fit.size(); i++) {
+      DumpStage(s, "  fit  ", fit[i]);
+    }
+    DumpStage(s, "  write", write);
+    if (reduce_seconds > 0) s << "  observables: " << reduce_seconds << " s\n";
+    for (size_t i = 0 ; i != input_queues.size(); i++) {
+      DumpQueue(s, "  input ", i, input_queues[i]);
+    }
+    for (size_t i = 0 ; i != output_queues.size(); i++) {
+      DumpQueue(s, "  output", i, output_queues[i]);
+    }
+    return s;
+  }
+
+  bpkHitFitPipeline::bpkHitFitPipeline(const bpkRunHitFit& fitter,
+				       int                 nfit,
+				       size_t              queue_depth,
+				       bool                useObjRes):
+    _fitters(nfit > 0 ? nfit : 1, fitter),
+    _useObjRes(useObjRes),
+    _deterministic(false),
+    _fillObservables(false)
+  {
+    if (queue_depth < 1) queue_depth = 1;
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      _inputQueues.push_back(new Bounded_Queue<bpkHitFitInput>(queue_depth));
+      _outputQueues.push_back(new Bounded_Queue<bpkHitFitOutput>(queue_depth));
+    }
+  }
+
+  bpkHitFitPipeline::~bpkHitFitPipeline()
+  {
+    for (size_t i = 0 ; i != _inputQueues.size(); i++) {
+      delete _inputQueues[i];
+      delete _outputQueues[i];
+    }
+  }
+
+  void bpkHitFitPipeline::Run(bpkHitFitSource& source, bpkHitFitSink& sink)
+  {
+    // The queues are drained and closed at the end of a run;
+    // start each run from fresh ones.
+    size_t queue_depth = _inputQueues[0]->capacity();
+    for (size_t i = 0 ; i != _inputQueues.size(); i++) {
+      delete _inputQueues[i];
+      delete _outputQueues[i];
+      _inputQueues[i]  = new Bounded_Queue<bpkHitFitInput>(queue_depth);
+      _outputQueues[i] = new Bounded_Queue<bpkHitFitOutput>(queue_depth);
+    }
+
+    _stats = bpkHitFitPipelineStats();
+    _stats.fit.resize(_fitters.size());
+    _reduceSeconds.assign(_fitters.size(), 0.);
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      _fitters[i].ResetPerf();
+      _fitters[i].ResetAllocAudit();
+    }
+
+    _observables.Reset();
+    for (size_t i = 0 ; i != _workerObservables.size(); i++) {
+      _workerObservables[i].Reset();
+    }
+
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread(&bpkHitFitPipeline::ReadStage, this, &source));
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      threads.push_back(std::thread(&bpkHitFitPipeline::FitStage, this, int(i)));
+    }
+    threads.push_back(std::thread(&bpkHitFitPipeline::WriteStage, this, &sink));
+
+    for (size_t i = 0 ; i != threads.size(); i++) {
+      threads[i].join();
+    }
+
+    _stats.wall_seconds = Seconds(start, Clock::now());
+
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      _stats.reduce_seconds += _reduceSeconds[i];
+      _stats.input_queues.push_back(QueueStats(*_inputQueues[i]));
+      _stats.output_queues.push_back(QueueStats(*_outputQueues[i]));
+    }
+
+    _perf.Reset();
+    _alloc = bpkHitFitAllocAudit();
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      _perf.Merge(_fitters[i].Perf());
+      _alloc.Merge(_fitters[i].AllocAudit());
+    }
+
+    if (_fillObservables && !_deterministic) {
+      Clock::time_point t0 = Clock::now();
+      for (size_t i = 0 ; i != _workerObservables.size(); i++) {
+	_observables.Merge(_workerObservables[i]);
+      }
+      _stats.reduce_seconds += Seconds(t0, Clock::now());
+    }
+  }
+
+  const bpkHitFitPipelineStats& bpkHitFitPipeline::Stats() const
+  {
+    return _stats;
+  }
+
+  void bpkHitFitPipeline::SetObservables(const bpkHitFitObservables& observables)
+  {
+    _fillObservables = true;
+    _observables = observables;
+    _observables.Reset();
+    _workerObservables.assign(_fitters.size(), _observables);
+  }
+
+  const bpkHitFitObservables& bpkHitFitPipeline::Observables() const
+  {
+    return _observables;
+  }
+
+  void bpkHitFitPipeline::SetDeterministic(bool on)
+  {
+    _deterministic = on;
+  }
+
+  const bpkHitFitPerf& bpkHitFitPipeline::Perf() const
+  {
+    return _perf;
+  }
+
+  const bpkHitFitAllocAudit& bpkHitFitPipeline::AllocAudit() const
+  {
+    return _alloc;
+  }
+
+  void bpkHitFitPipeline::ReadStage(bpkHitFitSource* source)
+  {
+    bpkHitFitStageStats& stats = _stats.read;
+    Clock::time_point start = Clock::now();
+
+    const size_t nfit = _inputQueues.size();
+    for (size_t k = 0 ; ; k++) {
+      Bounded_Queue<bpkHitFitInput>& queue = *_inputQueues[k % nfit];
+      bpkHitFitInput& input = queue.write_slot();
+      input.clear();
+      input.entry = k;
+
+      Clock::time_point t0 = Clock::now();
+      bool more = source->Next(input);
+      stats.busy_seconds += Seconds(t0, Clock::now());
+
+      if (!more) break;
+      queue.push();
+      stats.nevents++;
+    }
+
+    for (size_t i = 0 ; i != nfit; i++) {
+      _inputQueues[i]->close();
+    }
+    stats.wall_seconds = Seconds(start, Clock::now());
+  }
+
+  void bpkHitFitPipeline::FitStage(int worker)
+  {
+    bpkHitFitStageStats&            stats  = _stats.fit[worker];
+    bpkRunHitFit&                   fitter = _fitters[worker];
+    Bounded_Queue<bpkHitFitInput>&  in     = *_inputQueues[worker];
+    Bounded_Queue<bpkHitFitOutput>& out    = *_outputQueues[worker];
+    Clock::time_point start = Clock::now();
+    double reduce_seconds = 0;
+
+    while (const bpkHitFitInput* input = in.read_slot()) {
+      bpkHitFitOutput& output = out.write_slot();
+
+      Clock::time_point t0 = Clock::now();
+      fitter.FitEvent(*input, _useObjRes);
+      Clock::time_point t1 = Clock::now();
+      if (_fillObservables && !_deterministic) _workerObservables[worker].Fill(fitter);
+      Clock::time_point t2 = Clock::now();
+      output.Assign(fitter, *input);
+      stats.busy_seconds += Seconds(t0, Clock::now());
+      reduce_seconds += Seconds(t1, t2);
+
+      in.pop();
+      out.push();
+      stats.nevents++;
+    }
+
+    out.close();
+    stats.wall_seconds = Seconds(start, Clock::now());
+    _reduceSeconds[worker] = reduce_seconds;
+  }
+
+  void bpkHitFitPipeline::WriteStage(bpkHitFitSink* sink)
+  {
+    bpkHitFitStageStats& stats = _stats.write;
+    Clock::time_point start = Clock::now();
+
+    // Events were dealt round-robin, so the first worker without a
+    // next event marks the end of the input.
+    const size_t nfit = _outputQueues.size();
+    for (size_t k = 0 ; ; k++) {
+      Bounded_Queue<bpkHitFitOutput>& queue = *_outputQueues[k % nfit];
+      const bpkHitFitOutput* output = queue.read_slot();
+      if (!output) break;
+
+      Clock::time_point t0 = Clock::now();
+      sink->Write(*output);
+      Clock::time_point t1 = Clock::now();
+      stats.busy_seconds += Seconds(t0, t1);
+
+      if (_fillObservables && _deterministic) {
+	_observables.Fill(output->best >= 0 ? &output->results[output->best] : 0);
+	_stats.reduce_seconds += Seconds(t1, Clock::now());
+      }
+
+      queue.pop();
+      stats.nevents++;
+    }
+
+    stats.wall_seconds = Seconds(start, Clock::now());
+  }
+
+} // namespace hitfit
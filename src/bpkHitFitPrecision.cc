@@ -0,0 +1,172 @@
+#include <cmath>
+#include <iostream>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitPrecision.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+
+namespace hitfit{
+
+  namespace {
+
+    double RelDiff(double test, double reference)
+    {
+      return reference != 0 ? (test - reference) / std::fabs(reference) : 0.;
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitPrecisionReport::bpkHitFitPrecisionReport():
+    _chi2Diff(200, -0.1, 0.1),
+    _mtDiff(200, -0.1, 0.1),
+    _chi2RelDiff(200, -1e-3, 1e-3),
+    _mtRelDiff(200, -1e-5, 1e-5)
+  {
+    Reset();
+  }
+
+  void bpkHitFitPrecisionReport::Fit(bpkRunHitFit& reference, bpkRunHitFit& test,
+				     const bpkHitFitInput& input, bool useObjRes)
+  {
+    reference.FitEvent(input, useObjRes);
+    test.FitEvent(input, useObjRes);
+    Compare(reference, test);
+  }
+
+  void bpkHitFitPrecisionReport::Compare(const bpkRunHitFit& reference, const bpkRunHitFit& test)
+  {
+    _nevents++;
+
+    const size_t n = reference.NumFitResults();
+    bool layout = test.NumFitResults() == n;
+    for (size_t i = 0 ; layout && i != n; i++) {
+      layout = reference.GetPermutationCode(i) == test.GetPermutationCode(i);
+    }
+    if (!layout) {
+      _nlayout++;
+    } else {
+      for (size_t i = 0 ; i != n; i++) {
+	const Compact_Fit_Result& r = reference.GetCompactResult(i);
+	const Compact_Fit_Result& t = test.GetCompactResult(i);
+	_nperm++;
+	if ((r.chisq() >= 0) != (t.chisq() >= 0)) {
+	  _nstatus++;
+	  continue;
+	}
+	if (r.chisq() < 0) continue;
+	_chi2Diff.Fill(t.chisq() - r.chisq());
+	_mtDiff.Fill(t.mt() - r.mt());
+	_chi2RelDiff.Fill(RelDiff(t.chisq(), r.chisq()));
+	_mtRelDiff.Fill(RelDiff(t.mt(), r.mt()));
+      }
+    }
+
+    // The best permutations are compared by code, whatever the layout.
+    int rbest = reference.GetBestFit();
+    int tbest = test.GetBestFit();
+    if (rbest >= 0 && tbest >= 0) {
+      _nbest++;
+      if (reference.GetPermutationCode(rbest) == test.GetPermutationCode(tbest)) _nbestAgree++;
+    }
+  }
+
+  void bpkHitFitPrecisionReport::Merge(const bpkHitFitPrecisionReport& other)
+  {
+    _nevents    += other._nevents;
+    _nlayout    += other._nlayout;
+    _nperm      += other._nperm;
+    _nstatus    += other._nstatus;
+    _nbest      += other._nbest;
+    _nbestAgree += other._nbestAgree;
+    _chi2Diff.Merge(other._chi2Diff);
+    _mtDiff.Merge(other._mtDiff);
+    _chi2RelDiff.Merge(other._chi2RelDiff);
+    _mtRelDiff.Merge(other._mtRelDiff);
+  }
+
+  void bpkHitFitPrecisionReport::Reset()
+  {
+    _nevents    = 0;
+    _nlayout    = 0;
+    _nperm      = 0;
+    _nstatus    = 0;
+    _nbest      = 0;
+    _nbestAgree = 0;
+    _chi2Diff.Reset();
+    _mtDiff.Reset();
+    _chi2RelDiff.Reset();
+    _mtRelDiff.Reset();
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumEvents() const
+  {
+    return _nevents;
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumLayoutMismatch() const
+  {
+    return _nlayout;
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumPermutations() const
+  {
+    return _nperm;
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumStatusMismatch() const
+  {
+    return _nstatus;
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumBestCompared() const
+  {
+    return _nbest;
+  }
+
+  unsigned long bpkHitFitPrecisionReport::NumBestAgree() const
+  {
+    return _nbestAgree;
+  }
+
+  double bpkHitFitPrecisionReport::BestAgreement() const
+  {
+    return _nbest > 0 ? double(_nbestAgree) / _nbest : 0.;
+  }
+
+  const bpkHitFitHistogram& bpkHitFitPrecisionReport::Chi2Diff() const
+  {
+    return _chi2Diff;
+  }
+
+  const bpkHitFitHistogram& bpkHitFitPrecisionReport::MtDiff() const
+  {
+    return _mtDiff;
+  }
+
+  const bpkHitFitHistogram& bpkHitFitPrecisionReport::Chi2RelDiff() const
+  {
+    return _chi2RelDiff;
+  }
+
+  const bpkHitFitHistogram& bpkHitFitPrecisionReport::MtRelDiff() const
+  {
+    return _mtRelDiff;
+  }
+
+  std::ostream& bpkHitFitPrecisionReport::dump(std::ostream& s) const
+  {
+    s << "bpkHitFitPrecisionReport: " << _nevents << " events, "
+      << _nlayout << " with different permutation lists\n"
+      << "  permutations: " << _nperm << ", converged in one fit only: " << _nstatus << "\n"
+      << "  best permutation: " << _nbestAgree << " of " << _nbest
+      << " agree (" << 100. * BestAgreement() << "%)\n";
+    const char* names[4] = { "chi2 diff", "mt diff", "chi2 rel diff", "mt rel diff" };
+    const bpkHitFitHistogram* h[4] = { &_chi2Diff, &_mtDiff, &_chi2RelDiff, &_mtRelDiff };
+    for (int k = 0 ; k != 4; k++) {
+      s << "  " << names[k] << ": " << h[k]->Entries() << " entries, mean "
+	<< h[k]->Mean() << " rms " << h[k]->RMS() << " min " << h[k]->Min()
+	<< " max " << h[k]->Max() << "\n";
+    }
+    return s;
+  }
+
+} // namespace hitfit
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <iostream>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitShard.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitCache.h"
+
+namespace hitfit{
+
+  namespace {
+
+    struct CounterField {
+      const char*                         name;
+      unsigned long bpkRunHitFitCounters::* member;
+    };
+
+    const CounterField COUNTER_FIELDS[] = {
+      { "events",                &bpkRunHitFitCounters::events },
+      { "permutations",          &bpkRunHitFitCounters::permutations },
+      { "fits",                  &bpkRunHitFitCounters::fits },
+      { "tg_mass_pruned",        &bpkRunHitFitCounters::tg_mass_pruned },
+      { "tg_fits_saved",         &bpkRunHitFitCounters::tg_fits_saved },
+      { "prerank_skipped",       &bpkRunHitFitCounters::prerank_skipped },
+      { "prerank_validated",     &bpkRunHitFitCounters::prerank_validated },
+      { "twostage_refined",      &bpkRunHitFitCounters::twostage_refined },
+      { "twostage_validated",    &bpkRunHitFitCounters::twostage_validated },
+      { "twostage_best_refined", &bpkRunHitFitCounters::twostage_best_refined },
+      { "twostage_best_agree",   &bpkRunHitFitCounters::twostage_best_agree },
+      { "twostage_unconverged",  &bpkRunHitFitCounters::twostage_unconverged },
+      { "twostage_outside_margin", &bpkRunHitFitCounters::twostage_outside_margin },
+      { "nu_degenerate",         &bpkRunHitFitCounters::nu_degenerate },
+      { "ttbar_fits",            &bpkRunHitFitCounters::ttbar_fits },
+      { "lazy_refits",           &bpkRunHitFitCounters::lazy_refits },
+      { "cache_hits",            &bpkRunHitFitCounters::cache_hits },
+      { "cache_misses",          &bpkRunHitFitCounters::cache_misses }
+    };
+
+    const int N_COUNTER_FIELDS = sizeof(COUNTER_FIELDS) / sizeof(COUNTER_FIELDS[0]);
+
+    // Buffer of one entry of the shard info tree.
+    struct ShardInfo {
+
+      ShardInfo():
+	shard(0),
+	nshards(0),
+	nrank(0),
+	best_rank(MAX_HITFIT, 0),
+	wall_seconds(0.),
+	fit_busy_seconds(0.)
+      {
+	std::fill(counters, counters + N_COUNTER_FIELDS, 0);
+      }
+
+      void Book(TTree* tree)
+      {
+	tree->Branch("shard",   &shard,   "shard/I");
+	tree->Branch("nshards", &nshards, "nshards/I");
+	for (int k = 0 ; k != N_COUNTER_FIELDS; k++) {
+	  std::string name(COUNTER_FIELDS[k].name);
+	  tree->Branch(name.c_str(), &counters[k], (name + "/l").c_str());
+	}
+	tree->Branch("nrank", &nrank, "nrank/I");
+	tree->Branch("prerank_best_rank", &best_rank[0], "prerank_best_rank[nrank]/l");
+	tree->Branch("wall_seconds",     &wall_seconds,     "wall_seconds/D");
+	tree->Branch("fit_busy_seconds", &fit_busy_seconds, "fit_busy_seconds/D");
+      }
+
+      void SetAddresses(TTree* tree)
+      {
+	tree->SetBranchAddress("shard",   &shard);
+	tree->SetBranchAddress("nshards", &nshards);
+	for (int k = 0 ; k != N_COUNTER_FIELDS; k++) {
+	  tree->SetBranchAddress(COUNTER_FIELDS[k].name, &counters[k]);
+	}
+	tree->SetBranchAddress("nrank", &nrank);
+	tree->SetBranchAddress("prerank_best_rank", &best_rank[0]);
+	tree->SetBranchAddress("wall_seconds",     &wall_seconds);
+	tree->SetBranchAddress("fit_busy_seconds", &fit_busy_seconds);
+      }
+
+      void Set(const bpkRunHitFitCounters& c)
+      {
+	for (int k = 0 ; k != N_COUNTER_FIELDS; k++) {
+	  counters[k] = c.*(COUNTER_FIELDS[k].member);
+	}
+	nrank = std::min<size_t>(c.prerank_best_rank.size(), best_rank.size());
+	std::copy(c.prerank_best_rank.begin(), c.prerank_best_rank.begin() + nrank, best_rank.begin());
+      }
+
+      void Get(bpkRunHitFitCounters& c) const
+      {
+	for (int k = 0 ; k != N_COUNTER_FIELDS; k++) {
+	  c.*(COUNTER_FIELDS[k].member) = counters[k];
+	}
+	c.prerank_best_rank.assign(best_rank.begin(), best_rank.begin() + nrank);
+      }
+
+      Int_t                  shard;
+      Int_t                  nshards;
+      ULong64_t              counters[N_COUNTER_FIELDS];
+      Int_t                  nrank;
+      std::vector<ULong64_t> best_rank;
+      Double_t               wall_seconds;
+      Double_t               fit_busy_seconds;
+    };
+
+  } // unnamed namespace
+
+  bpkHitFitShardSource::bpkHitFitShardSource(bpkHitFitSource& source,
+					     int              nshards,
+					     int              shard,
+					     Mode             mode,
+					     long             nevents):
+    _source(source),
+    _nshards(nshards > 0 ? nshards : 1),
+    _shard(shard),
+    _mode(mode),
+    _nevents(nevents),
+    _nread(0),
+    _naccepted(0)
+  {
+    if (_mode == by_range && _nevents < 0) {
+      std::cerr << "bpkHitFitShardSource: by_range needs the number of events,"
+		<< " falling back to by_hash" << std::endl;
+      _mode = by_hash;
+    }
+  }
+
+  bool bpkHitFitShardSource::Next(bpkHitFitInput& input)
+  {
+    for (;;) {
+      long entry = _nread;
+
+      // The range of the last shard is the last one of the input.
+      if (_mode == by_range && ShardOf(entry, 0, 0, _nshards, _mode, _nevents) > _shard) return false;
+
+      input.clear();
+      if (!_source.Next(input)) return false;
+      _nread++;
+
+      if (ShardOf(entry, input.runnum, input.evnum, _nshards, _mode, _nevents) == _shard) {
+	input.entry = entry;
+	_naccepted++;
+	return true;
+      }
+    }
+  }
+
+  long bpkHitFitShardSource::NumRead() const
+  {
+    return _nread;
+  }
+
+  long bpkHitFitShardSource::NumAccepted() const
+  {
+    return _naccepted;
+  }
+
+  int bpkHitFitShardSource::ShardOf(long entry, int runnum, int evnum,
+				    int nshards, Mode mode, long nevents)
+  {
+    if (nshards <= 1) return 0;
+    if (mode == by_range) {
+      if (nevents <= 0 || entry >= nevents) return nshards;
+      // Shard s begins at entry floor(s*nevents/nshards), so this is
+      // the largest s with floor(s*nevents/nshards) <= entry, that is
+      // with s*nevents < (entry+1)*nshards: s = ceil((entry+1)*nshards/nevents) - 1.
+      // E.g. nevents 10, nshards 3: shards begin at 0, 3 and 6.
+      return ((entry + 1) * nshards - 1) / nevents;
+    }
+    uint64_t h = bpkHitFitCache::Hash(&runnum, sizeof(runnum));
+    h = bpkHitFitCache::Hash(&evnum, sizeof(evnum), h);
+    return h % nshards;
+  }
+
+  const char* const bpkHitFitShardMerger::SHARD_INFO_TREE = "hitfit_shards";
+
+  bpkHitFitShardMerger::bpkHitFitShardMerger(const std::string& tree_name,
+					     const std::string& prefix):
+    _tree_name(tree_name),
+    _prefix(prefix),
+    _nentries(0)
+  {
+  }
+
+  void bpkHitFitShardMerger::Add(const std::string& file)
+  {
+    _files.push_back(file);
+  }
+
+  Long64_t bpkHitFitShardMerger::NumEntries() const
+  {
+    return _nentries;
+  }
+
+  const bpkRunHitFitCounters& bpkHitFitShardMerger::Counters() const
+  {
+    return _counters;
+  }
+
+  bool bpkHitFitShardMerger::Merge(TDirectory* dir)
+  {
+    _nentries = 0;
+    _counters = bpkRunHitFitCounters();
+
+    std::vector<TFile*> files;
+    std::vector<TTree*> trees;
+    std::vector<TTree*> infos;
+    bool ok = !_files.empty();
+    for (size_t s = 0 ; ok && s != _files.size(); s++) {
+      TFile* file = TFile::Open(_files[s].c_str(), "READ");
+      if (!file || file->IsZombie()) {
+	std::cerr << "bpkHitFitShardMerger: cannot open " << _files[s] << std::endl;
+	delete file;
+	ok = false;
+	break;
+      }
+      files.push_back(file);
+      TTree* tree = dynamic_cast<TTree*>(file->Get(_tree_name.c_str()));
+      if (!tree) {
+	std::cerr << "bpkHitFitShardMerger: no tree " << _tree_name << " in " << _files[s] << std::endl;
+	ok = false;
+	break;
+      }
+      trees.push_back(tree);
+      TTree* info = dynamic_cast<TTree*>(file->Get(SHARD_INFO_TREE));
+      if (info) infos.push_back(info);
+    }
+
+    if (ok) {
+      ok = MergeResults(trees, dir);
+      MergeShardInfo(infos, dir);
+    }
+
+    for (size_t s = 0 ; s != files.size(); s++) {
+      files[s]->Close();
+      delete files[s];
+    }
+    return ok;
+  }
+
+  bool bpkHitFitShardMerger::MergeResults(const std::vector<TTree*>& trees, TDirectory* dir)
+  {
+    const size_t nshards = trees.size();
+    const std::string entry_name = _prefix + "entry";
+
+    // Order by the entry column if every shard has one,
+    // otherwise concatenate.
+    bool by_entry = true;
+    for (size_t s = 0 ; s != nshards; s++) {
+      if (!trees[s]->GetBranch(entry_name.c_str())) by_entry = false;
+    }
+
+    std::vector<Long64_t> entry(nshards, -1);
+    std::vector<Long64_t> pos(nshards, 0);
+    std::vector<Long64_t> size(nshards, 0);
+    for (size_t s = 0 ; s != nshards; s++) {
+      if (by_entry) trees[s]->SetBranchAddress(entry_name.c_str(), &entry[s]);
+      size[s] = trees[s]->GetEntries();
+      if (size[s] > 0) trees[s]->GetEntry(0);
+    }
+
+    // The merged tree takes the branch buffers of one shard at a time.
+    dir->cd();
+    TTree* out = trees[0]->CloneTree(0);
+    if (!out) return false;
+    out->SetDirectory(dir);
+    size_t current = 0;
+
+    for (;;) {
+      size_t next = nshards;
+      for (size_t s = 0 ; s != nshards; s++) {
+	if (pos[s] == size[s]) continue;
+	if (next == nshards) {
+	  next = s;
+	  if (!by_entry) break;
+	} else if (entry[s] < entry[next]) {
+	  next = s;
+	}
+      }
+      if (next == nshards) break;
+
+      if (next != current) {
+	trees[next]->CopyAddresses(out);
+	current = next;
+      }
+      out->Fill();
+      _nentries++;
+      if (++pos[next] < size[next]) trees[next]->GetEntry(pos[next]);
+    }
+
+    out->Write();
+    return true;
+  }
+
+  void bpkHitFitShardMerger::MergeShardInfo(const std::vector<TTree*>& trees, TDirectory* dir)
+  {
+    dir->cd();
+    TTree* out = new TTree(SHARD_INFO_TREE, "bpkHitFit shard instrumentation");
+    out->SetDirectory(dir);
+
+    ShardInfo info;
+    info.Book(out);
+    for (size_t s = 0 ; s != trees.size(); s++) {
+      info.SetAddresses(trees[s]);
+      for (Long64_t i = 0 ; i != trees[s]->GetEntries(); i++) {
+	trees[s]->GetEntry(i);
+	out->Fill();
+	bpkRunHitFitCounters counters;
+	info.Get(counters);
+	_counters += counters;
+      }
+    }
+    out->Write();
+  }
+
+  void bpkHitFitShardMerger::WriteShardInfo(TDirectory*                   dir,
+					    int                           shard,
+					    int                           nshards,
+					    const bpkRunHitFitCounters&   counters,
+					    const bpkHitFitPipelineStats* stats)
+  {
+    dir->cd();
+    TTree* tree = new TTree(SHARD_INFO_TREE, "bpkHitFit shard instrumentation");
+    tree->SetDirectory(dir);
+
+    ShardInfo info;
+    info.Book(tree);
+    info.shard   = shard;
+    info.nshards = nshards;
+    info.Set(counters);
+    if (stats) {
+      info.wall_seconds = stats->wall_seconds;
+      for (size_t i = 0 ; i != stats->fit.size(); i++) {
+	info.fit_busy_seconds += stats->fit[i].busy_seconds;
+      }
+    }
+    tree->Fill();
+    tree->Write();
+    delete tree;
+  }
+
+} // namespace hitfit
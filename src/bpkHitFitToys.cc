@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitToys.h"
+#include "MyAna/bpkHitFitForExcitedQuark/interface/Counter_Random_Engine.h"
+
+namespace hitfit{
+
+  namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double Seconds(const Clock::time_point& start, const Clock::time_point& stop)
+    {
+      return std::chrono::duration<double>(stop - start).count();
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitToyStats::bpkHitFitToyStats():
+    ntoys(0),
+    smear_seconds(0.),
+    fit_seconds(0.),
+    wall_seconds(0.)
+  {
+  }
+
+  bpkHitFitToys::bpkHitFitToys(const TopGluon_Fit& fitter,
+			       int                 nthreads,
+			       size_t              batch_size,
+			       bool                smear_dir):
+    _fitters(nthreads > 0 ? nthreads : 1, fitter),
+    _batch_size(batch_size > 0 ? batch_size : 1),
+    _smear_dir(smear_dir),
+    _ev(0),
+    _nuz(false),
+    _ntoys(0),
+    _key(0),
+    _nbatches(0),
+    _next_batch(0)
+  {
+  }
+
+  void bpkHitFitToys::Run(const Lepjets_Event& ev, bool nuz, unsigned long ntoys, uint64_t key)
+  {
+    _ev    = &ev;
+    _nuz   = nuz;
+    _ntoys = ntoys;
+    _key   = key;
+
+    _nbatches = (ntoys + _batch_size - 1) / _batch_size;
+    if (_batches.size() < _nbatches) _batches.resize(_nbatches);
+    _next_batch = 0;
+
+    _smear_seconds.assign(_fitters.size(), 0.);
+    _fit_seconds.assign(_fitters.size(), 0.);
+
+    Clock::time_point start = Clock::now();
+
+    size_t nthreads = std::min<unsigned long>(_fitters.size(), _nbatches);
+    if (nthreads <= 1) {
+      Worker(0);
+    } else {
+      std::vector<std::thread> threads;
+      for (size_t i = 0 ; i != nthreads; i++) {
+	threads.push_back(std::thread(&bpkHitFitToys::Worker, this, int(i)));
+      }
+      for (size_t i = 0 ; i != threads.size(); i++) {
+	threads[i].join();
+      }
+    }
+
+    _stats = bpkHitFitToyStats();
+    _stats.ntoys        = ntoys;
+    _stats.wall_seconds = Seconds(start, Clock::now());
+    for (size_t i = 0 ; i != _fitters.size(); i++) {
+      _stats.smear_seconds += _smear_seconds[i];
+      _stats.fit_seconds   += _fit_seconds[i];
+    }
+    _ev = 0;
+  }
+
+  unsigned long bpkHitFitToys::NumToys() const
+  {
+    return _ntoys;
+  }
+
+  const Lepjets_Event& bpkHitFitToys::GetToyEvent(unsigned long i) const
+  {
+    return _batches[i / _batch_size].events[i % _batch_size];
+  }
+
+  const Fit_Result& bpkHitFitToys::GetToyResult(unsigned long i) const
+  {
+    return _batches[i / _batch_size].results[i % _batch_size];
+  }
+
+  const bpkHitFitToyStats& bpkHitFitToys::Stats() const
+  {
+    return _stats;
+  }
+
+  uint64_t bpkHitFitToys::EventKey(int runnum, int evnum, uint32_t seed)
+  {
+    // Run and event number in the low and high word; seed selects
+    // an independent set of toys for the same events.
+    return (uint64_t(uint32_t(runnum)) | (uint64_t(uint32_t(evnum)) << 32))
+      ^ (uint64_t(seed) * 0x9E3779B97F4A7C15ULL);
+  }
+
+  void bpkHitFitToys::Worker(int worker)
+  {
+    // Batches are picked up in whatever order the threads get to them;
+    // where a toy ends up and what it draws only depends on its index.
+    for (;;) {
+      unsigned long b = _next_batch++;
+      if (b >= _nbatches) break;
+      RunBatch(worker, b);
+    }
+  }
+
+  void bpkHitFitToys::RunBatch(int worker, unsigned long b)
+  {
+    Batch& batch = _batches[b];
+    TopGluon_Fit& fitter = _fitters[worker];
+
+    unsigned long first = b * _batch_size;
+    unsigned long last  = std::min<unsigned long>(first + _batch_size, _ntoys);
+
+    // Generate the smeared inputs of the whole batch.
+    Clock::time_point t0 = Clock::now();
+    Counter_Random_Engine engine;
+    batch.events.reset();
+    for (unsigned long i = first ; i != last; i++) {
+      engine.reset(_key, i);
+      batch.events.push_back(*_ev);
+      batch.events.back().smear(engine, _smear_dir);
+    }
+
+    // Fit them.
+    Clock::time_point t1 = Clock::now();
+    Lepjets_Event fev(0,0);
+    Column_Vector pullx;
+    Column_Vector pully;
+    batch.results.reset();
+    for (unsigned long i = 0 ; i != batch.events.size(); i++) {
+      fev = batch.events[i];
+      bool nuz = _nuz;
+      double umwhad;
+      double utmass;
+      double mt;
+      double sigmt;
+      double chisq = fitter.fit_one_perm(fev,nuz,umwhad,utmass,mt,sigmt,pullx,pully);
+      batch.results.push_back(Fit_Result(chisq,fev,pullx,pully,umwhad,utmass,mt,sigmt));
+    }
+    Clock::time_point t2 = Clock::now();
+
+    _smear_seconds[worker] += Seconds(t0, t1);
+    _fit_seconds[worker]   += Seconds(t1, t2);
+  }
+
+} // namespace hitfit
@@ -0,0 +1,326 @@
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#include "TTree.h"
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitWriter.h"
+
+namespace hitfit{
+
+  namespace {
+
+    // Name and label of the four-vectors stored per permutation;
+    // the lepton and the neutrino are not jets and are handled apart.
+    const char* const P4_NAMES[] = {
+      "lep", "nu", "lepb", "hadb", "hadw1", "hadw2", "gluon1", "gluon2"
+    };
+
+    const int P4_LABELS[] = {
+      lepton_label, nu_label, lepb_label, hadb_label,
+      hadw1_label, hadw2_label, gluon1_label, gluon2_label
+    };
+
+    // Initial number of permutations the arrays hold; they grow for
+    // larger events, an 8-jet t+g event gives up to 20160 results.
+    const int MIN_PERM = 2*MAX_HITFIT;
+
+    // Book the array branch, or point it at address after the
+    // array was moved.
+    void BindArray(TTree* tree, bool book, const std::string& prefix,
+		   const std::string& name, void* address, char type)
+    {
+      if (!book) {
+	tree->SetBranchAddress((prefix + name).c_str(), address);
+	return;
+      }
+      std::string leaflist = prefix + name + "[" + prefix + "nperm]/" + type;
+      tree->Branch((prefix + name).c_str(), address, leaflist.c_str());
+    }
+
+    // Add jet momentum pj to the four-vectors p of P4_NAMES.  Both W
+    // jets carry hadw1_label, so they are told apart by position: the
+    // first is hadw1 and the second hadw2.
+    void AddJet(int label, int& wjet, const Fourvec& pj, Fourvec p[])
+    {
+      if (label == hadw1_label || label == hadw2_label) {
+	label = wjet++ == 0 ? hadw1_label : hadw2_label;
+      }
+      for (int k = 2 ; k != sizeof(P4_LABELS)/sizeof(P4_LABELS[0]) ; k++) {
+	if (P4_LABELS[k] == label) p[k] += pj;
+      }
+    }
+
+    void GetP4(const Lepjets_Event& ev, Fourvec p[])
+    {
+      p[0] = ev.nleps() > 0 ? ev.lep(0).p() : Fourvec();
+      p[1] = ev.met();
+      int wjet = 0;
+      for (std::vector<Lepjets_Event_Jet>::size_type j = 0 ; j != ev.njets(); j++) {
+	AddJet(ev.jet(j).type(), wjet, ev.jet(j).p(), p);
+      }
+    }
+
+    void GetP4(const Compact_Event& ev, Fourvec p[])
+    {
+      p[0] = ev.nleps() > 0 ? ev.p(0) : Fourvec();
+      p[1] = ev.met();
+      int wjet = 0;
+      for (std::vector<double>::size_type i = ev.nleps() ; i != ev.nobjs(); i++) {
+	AddJet(ev.type[i], wjet, ev.p(i), p);
+      }
+    }
+
+  } // unnamed namespace
+
+  bpkHitFitWriter::bpkHitFitWriter(TTree*             tree,
+				   const std::string& columns,
+				   const std::string& prefix):
+    _tree(tree),
+    _columns(ParseColumns(columns)),
+    _p4_bits(23),
+    _pull_bits(23),
+    _runnum(0),
+    _evnum(0),
+    _entry(-1),
+    _njets(0),
+    _nperm(0),
+    _npullx_tot(0),
+    _npully_tot(0),
+    _prefix(prefix),
+    _capacity(0)
+  {
+    _tree->Branch((prefix + "runnum").c_str(), &_runnum, (prefix + "runnum/I").c_str());
+    _tree->Branch((prefix + "evnum").c_str(),  &_evnum,  (prefix + "evnum/I").c_str());
+    _tree->Branch((prefix + "njets").c_str(),  &_njets,  (prefix + "njets/I").c_str());
+    _tree->Branch((prefix + "nperm").c_str(),  &_nperm,  (prefix + "nperm/I").c_str());
+    if (_columns & entry_column) {
+      _tree->Branch((prefix + "entry").c_str(), &_entry, (prefix + "entry/L").c_str());
+    }
+
+    if (_columns & pull_column) {
+      _tree->Branch((prefix + "npullx_tot").c_str(), &_npullx_tot,
+		    (prefix + "npullx_tot/I").c_str());
+      _tree->Branch((prefix + "npully_tot").c_str(), &_npully_tot,
+		    (prefix + "npully_tot/I").c_str());
+    }
+
+    Reserve(MIN_PERM, true);
+  }
+
+  void bpkHitFitWriter::Reserve(int nperm, bool book)
+  {
+    if (!book && nperm <= _capacity) return;
+    _capacity = book ? nperm : std::max(nperm, 2*_capacity);
+
+    // ROOT keeps the addresses of the arrays; they are set again
+    // whenever the arrays move.
+    const std::string& prefix = _prefix;
+    if (_columns & chi2_column) {
+      _chi2.resize(_capacity);
+      BindArray(_tree, book, prefix, "chi2", &_chi2[0], 'F');
+    }
+    if (_columns & mt_column) {
+      _mt.resize(_capacity);
+      BindArray(_tree, book, prefix, "mt", &_mt[0], 'F');
+    }
+    if (_columns & sigmt_column) {
+      _sigmt.resize(_capacity);
+      BindArray(_tree, book, prefix, "sigmt", &_sigmt[0], 'F');
+    }
+    if (_columns & umwhad_column) {
+      _umwhad.resize(_capacity);
+      BindArray(_tree, book, prefix, "umwhad", &_umwhad[0], 'F');
+    }
+    if (_columns & utmass_column) {
+      _utmass.resize(_capacity);
+      BindArray(_tree, book, prefix, "utmass", &_utmass[0], 'F');
+    }
+    if (_columns & perm_column) {
+      _perm.resize(_capacity);
+      BindArray(_tree, book, prefix, "perm", &_perm[0], 'I');
+    }
+    if (_columns & p4_column) {
+      for (int k = 0 ; k != N_P4 ; k++) {
+	std::string name(P4_NAMES[k]);
+	_px[k].resize(_capacity);
+	_py[k].resize(_capacity);
+	_pz[k].resize(_capacity);
+	_e[k].resize(_capacity);
+	BindArray(_tree, book, prefix, name + "_px", &_px[k][0], 'F');
+	BindArray(_tree, book, prefix, name + "_py", &_py[k][0], 'F');
+	BindArray(_tree, book, prefix, name + "_pz", &_pz[k][0], 'F');
+	BindArray(_tree, book, prefix, name + "_e",  &_e[k][0],  'F');
+      }
+    }
+    if (_columns & tgmass_column) {
+      _mtg_lep.resize(_capacity);
+      _mtg_had.resize(_capacity);
+      BindArray(_tree, book, prefix, "mtg_lep", &_mtg_lep[0], 'F');
+      BindArray(_tree, book, prefix, "mtg_had", &_mtg_had[0], 'F');
+    }
+    if (_columns & pull_column) {
+      _npullx.resize(_capacity);
+      _npully.resize(_capacity);
+      _pullx.resize(_capacity*MAX_HITFIT_VAR);
+      _pully.resize(_capacity*MAX_HITFIT_VAR);
+      BindArray(_tree, book, prefix, "npullx", &_npullx[0], 'I');
+      BindArray(_tree, book, prefix, "npully", &_npully[0], 'I');
+      if (book) {
+	_tree->Branch((prefix + "pullx").c_str(), &_pullx[0],
+		      (prefix + "pullx[" + prefix + "npullx_tot]/F").c_str());
+	_tree->Branch((prefix + "pully").c_str(), &_pully[0],
+		      (prefix + "pully[" + prefix + "npully_tot]/F").c_str());
+      } else {
+	_tree->SetBranchAddress((prefix + "pullx").c_str(), &_pullx[0]);
+	_tree->SetBranchAddress((prefix + "pully").c_str(), &_pully[0]);
+      }
+    }
+  }
+
+  bpkHitFitWriter::~bpkHitFitWriter()
+  {
+  }
+
+  void bpkHitFitWriter::SetP4Precision(int nbits)
+  {
+    _p4_bits = nbits;
+  }
+
+  void bpkHitFitWriter::SetPullPrecision(int nbits)
+  {
+    _pull_bits = nbits;
+  }
+
+  unsigned int bpkHitFitWriter::Columns() const
+  {
+    return _columns;
+  }
+
+  void bpkHitFitWriter::Fill(const bpkRunHitFit& fitter, int runnum, int evnum, long entry)
+  {
+    // From the compact results, no Fit_Result is rebuilt.
+    int nperm = fitter.NumFitResults();
+    int njets = nperm > 0 ? fitter.GetCompactResult(0).ev().njets() : 0;
+    Reserve(nperm);
+    Begin(runnum, evnum, entry, njets, nperm);
+    for (int i = 0 ; i != nperm ; i++) {
+      FillPermutation(i, fitter.GetCompactResult(i), fitter.GetPermutationCode(i));
+    }
+    _tree->Fill();
+  }
+
+  void bpkHitFitWriter::Fill(const bpkHitFitOutput& output)
+  {
+    int nperm = output.results.size();
+    Reserve(nperm);
+    Begin(output.runnum, output.evnum, output.entry, output.njets, nperm);
+    for (int i = 0 ; i != nperm ; i++) {
+      FillPermutation(i, output.results[i], output.codes[i]);
+    }
+    _tree->Fill();
+  }
+
+  void bpkHitFitWriter::Begin(int runnum, int evnum, long entry, int njets, int nperm)
+  {
+    _runnum     = runnum;
+    _evnum      = evnum;
+    _entry      = entry;
+    _njets      = njets;
+    _nperm      = nperm;
+    _npullx_tot = 0;
+    _npully_tot = 0;
+  }
+
+  template <class Result>
+  void bpkHitFitWriter::FillPermutation(int i, const Result& result, int code)
+  {
+
+    if (_columns & chi2_column)   _chi2[i]   = result.chisq();
+    if (_columns & mt_column)     _mt[i]     = result.mt();
+    if (_columns & sigmt_column)  _sigmt[i]  = result.sigmt();
+    if (_columns & umwhad_column) _umwhad[i] = result.umwhad();
+    if (_columns & utmass_column) _utmass[i] = result.utmass();
+    if (_columns & perm_column)   _perm[i]   = code;
+
+    if (_columns & p4_column) {
+      Fourvec p[N_P4];
+      GetP4(result.ev(), p);
+      for (int k = 0 ; k != N_P4 ; k++) {
+	_px[k][i] = ReduceMantissa(p[k].x(), _p4_bits);
+	_py[k][i] = ReduceMantissa(p[k].y(), _p4_bits);
+	_pz[k][i] = ReduceMantissa(p[k].z(), _p4_bits);
+	_e[k][i]  = ReduceMantissa(p[k].e(), _p4_bits);
+      }
+    }
+
+    if (_columns & tgmass_column) {
+      Decay_Masses m = Lepjets_Event_Sums::decay_masses(result.ev());
+      _mtg_lep[i] = m.tg_lep;
+      _mtg_had[i] = m.tg_had;
+    }
+
+    if (_columns & pull_column) {
+      const Column_Vector& pullx = result.pullx();
+      const Column_Vector& pully = result.pully();
+      _npullx[i] = std::min<int>(pullx.num_row(), MAX_HITFIT_VAR);
+      _npully[i] = std::min<int>(pully.num_row(), MAX_HITFIT_VAR);
+      for (int k = 0 ; k != _npullx[i] ; k++)
+	_pullx[_npullx_tot++] = ReduceMantissa(pullx[k], _pull_bits);
+      for (int k = 0 ; k != _npully[i] ; k++)
+	_pully[_npully_tot++] = ReduceMantissa(pully[k], _pull_bits);
+    }
+  }
+
+  unsigned int bpkHitFitWriter::ParseColumns(const std::string& columns)
+  {
+    static const char* const names[] = {
+      "chi2", "mt", "sigmt", "umwhad", "utmass", "perm", "p4", "tgmass", "pull", "entry"
+    };
+    static const int nnames = sizeof(names) / sizeof(names[0]);
+
+    unsigned int mask = 0;
+    std::string::size_type pos = 0;
+    while (pos < columns.size()) {
+      std::string::size_type end = columns.find_first_of(", ", pos);
+      if (end == std::string::npos) end = columns.size();
+      std::string name = columns.substr(pos, end - pos);
+      pos = end + 1;
+      if (name.empty()) continue;
+      if (name == "all") {
+	mask |= all_columns;
+	continue;
+      }
+      bool found = false;
+      for (int k = 0 ; k != nnames ; k++) {
+	if (name == names[k]) {
+	  mask |= 1u << k;
+	  found = true;
+	}
+      }
+      if (!found)
+	std::cout<<"bpkHitFitWriter: unknown column "<<name<<" ignored"<<std::endl;
+    }
+    return mask;
+  }
+
+  float bpkHitFitWriter::ReduceMantissa(float x, int nbits)
+  {
+    // Round the 23-bit float mantissa to nbits, to nearest.
+    if (nbits >= 23 || nbits < 0) return x;
+
+    unsigned int bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    // Leave infinities and NaN alone.
+    if ((bits & 0x7f800000u) == 0x7f800000u) return x;
+
+    const unsigned int shift = 23 - nbits;
+    bits += 1u << (shift - 1);
+    bits &= ~((1u << shift) - 1);
+
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+  }
+
+} // namespace hitfit
@@ -1,7 +1,14 @@
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 
 #include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
 #include "TopQuarkAnalysis/TopHitFit/interface/Defaults_Text.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/Top_Decaykin.h"
 #include "MyAna/bprimeKit/interface/format.h"
 
 // Explanation about the MIN/MAX definitions:
@@ -39,6 +46,161 @@
 
 namespace hitfit{
 
+  namespace {
+
+    // Jet types receiving the b jet energy correction and resolution
+    // in JetTranslator.
+    bool IsBJetType(int type)
+    {
+      return type == hadb_label || type == lepb_label || type == higgs_label;
+    }
+
+    // Jets outside the slots of the hypothesis: ISR, or unknown in the
+    // permutations of GetPermutationTable().
+    bool IsExtraJetType(int type)
+    {
+      return type == isr_label || type == unknown_label;
+    }
+
+    // Weights of the pre-ranking score, in units of chi2.
+    const double PRERANK_SIGMA_W    = 10.;  // GeV, hadronic W mass
+    const double PRERANK_SIGMA_TOP  = 20.;  // GeV, leptonic - hadronic top mass
+    const double PRERANK_BTAG       = 4.;   // per tagged jet not in a b slot
+    const double PRERANK_PT_ORDER   = 1.;   // per extra jet harder than an assigned jet
+
+    // Order candidate indices by score, ties by index.
+    struct ScoreOrder {
+      const std::vector<double>& scores;
+      explicit ScoreOrder(const std::vector<double>& s) : scores(s) {}
+      bool operator()(int a, int b) const
+      {
+	return scores[a] < scores[b] || (scores[a] == scores[b] && a < b);
+      }
+    };
+
+    // Version of the cached results, part of the configuration hash;
+    // to be increased when the payload or the fit changes.
+    const uint32_t CACHE_FORMAT = 1;
+
+    template <class T>
+    uint64_t HashValue(uint64_t h, const T& x)
+    {
+      return bpkHitFitCache::Hash(&x, sizeof(x), h);
+    }
+
+    template <class T>
+    void Put(std::vector<char>& buf, const T& x)
+    {
+      const char* p = reinterpret_cast<const char*>(&x);
+      buf.insert(buf.end(), p, p + sizeof(x));
+    }
+
+    // Read x from p, checking against the end of the buffer.
+    template <class T>
+    bool Get(const char*& p, const char* end, T& x)
+    {
+      if (end - p < ptrdiff_t(sizeof(x))) return false;
+      memcpy(&x, p, sizeof(x));
+      p += sizeof(x);
+      return true;
+    }
+
+    void PutFourvec(std::vector<char>& buf, const Fourvec& v)
+    {
+      Put(buf, v.x());
+      Put(buf, v.y());
+      Put(buf, v.z());
+      Put(buf, v.e());
+    }
+
+    bool GetFourvec(const char*& p, const char* end, Fourvec& v)
+    {
+      double x, y, z, e;
+      if (!Get(p, end, x) || !Get(p, end, y) || !Get(p, end, z) || !Get(p, end, e)) return false;
+      v = Fourvec(x, y, z, e);
+      return true;
+    }
+
+    void PutVector(std::vector<char>& buf, const Column_Vector& v)
+    {
+      Put(buf, int32_t(v.num_row()));
+      for (int k = 0 ; k != v.num_row(); k++) Put(buf, v[k]);
+    }
+
+    bool GetVector(const char*& p, const char* end, Column_Vector& v)
+    {
+      int32_t n;
+      if (!Get(p, end, n) || n < 0) return false;
+      v = n > 0 ? Column_Vector(n) : Column_Vector();
+      for (int k = 0 ; k != n; k++) {
+	if (!Get(p, end, v[k])) return false;
+      }
+      return true;
+    }
+
+  } // unnamed namespace
+
+  bpkRunHitFitCounters::bpkRunHitFitCounters():
+    events(0),
+    permutations(0),
+    fits(0),
+    tg_mass_pruned(0),
+    tg_fits_saved(0),
+    prerank_skipped(0),
+    prerank_validated(0),
+    twostage_refined(0),
+    twostage_validated(0),
+    twostage_best_refined(0),
+    twostage_best_agree(0),
+    twostage_unconverged(0),
+    twostage_outside_margin(0),
+    nu_degenerate(0),
+    ttbar_fits(0),
+    lazy_refits(0),
+    cache_hits(0),
+    cache_misses(0)
+  {
+  }
+
+  double bpkRunHitFitCounters::prerank_recall(size_t n) const
+  {
+    if (prerank_validated == 0) return 0.;
+    unsigned long nrecalled = 0;
+    for (size_t r = 0 ; r < n && r < prerank_best_rank.size(); r++) {
+      nrecalled += prerank_best_rank[r];
+    }
+    return double(nrecalled) / prerank_validated;
+  }
+
+  bpkRunHitFitCounters& bpkRunHitFitCounters::operator+=(const bpkRunHitFitCounters& other)
+  {
+    events                += other.events;
+    permutations          += other.permutations;
+    fits                  += other.fits;
+    tg_mass_pruned        += other.tg_mass_pruned;
+    tg_fits_saved         += other.tg_fits_saved;
+    prerank_skipped       += other.prerank_skipped;
+    prerank_validated     += other.prerank_validated;
+    if (prerank_best_rank.size() < other.prerank_best_rank.size()) {
+      prerank_best_rank.resize(other.prerank_best_rank.size(), 0);
+    }
+    for (size_t r = 0 ; r != other.prerank_best_rank.size(); r++) {
+      prerank_best_rank[r] += other.prerank_best_rank[r];
+    }
+    twostage_refined      += other.twostage_refined;
+    twostage_validated    += other.twostage_validated;
+    twostage_best_refined += other.twostage_best_refined;
+    twostage_best_agree   += other.twostage_best_agree;
+    twostage_unconverged  += other.twostage_unconverged;
+    twostage_outside_margin += other.twostage_outside_margin;
+    nu_degenerate         += other.nu_degenerate;
+    ttbar_fits            += other.ttbar_fits;
+    lazy_refits           += other.lazy_refits;
+    cache_hits            += other.cache_hits;
+    cache_misses          += other.cache_misses;
+    return *this;
+  }
+
   bpkRunHitFit::bpkRunHitFit(const LeptonTranslator& lep,
 			     const JetTranslator&    jet,
 			     const METTranslator&    met,
@@ -52,11 +214,48 @@ namespace hitfit{
     _METTranslator(met),
     _event(0,0),
     _jetObjRes(false),
-    //_Top_Fit(Top_Fit_Args(Defaults_Text(default_file)),lepw_mass,hadw_mass,top_mass)
     _TopGluon_Fit(TopGluon_Fit_Args(Defaults_Text(default_file)),lepw_mass,hadw_mass,top_mass),
-    _nu_solution(nu_sol)
+    _nu_solution(nu_sol),
+    _fev(0,0),
+    _builtEv(0,0),
+    _builtValid(false),
+    _compactSource(0,0),
+    _unfittedEv(0,0),
+    _resultEv(0,0),
+    _result(-999,Lepjets_Event(0,0),Column_Vector(),Column_Vector(),0,0,0,0),
+    _default_file(default_file),
+    _lepw_mass(lepw_mass),
+    _hadw_mass(hadw_mass),
+    _top_mass(top_mass),
+    _scanEv(0,0),
+    _twoStageMaxit(0),
+    _twoStageEps(0),
+    _twoStageMargin(0),
+    _twoStageValidate(false),
+    _tgMassMin(0),
+    _tgMassMax(0),
+    _tgEqualSideTolerance(0),
+    _preRankTopN(0),
+    _preRankDelta(0),
+    _preRankValidate(false),
+    _nuzValid(false),
+    _singlePrecision(false),
+    _lazyPulls(0),
+    _deterministic(false),
+    _usePerf(false),
+    _allocAudit(false),
+    _allocWarmJets(0),
+    _allocWarmResults(0),
+    _cache(0),
+    _cacheExtraHash(0),
+    _defaultFileHash(0)
   {
     if(_nu_solution<0 || _nu_solution>1) _nu_solution=2;
+    _jets.reserve(MAX_HITFIT_JET);
+    _jetInputs.reserve(MAX_HITFIT_JET);
+    _bJets.reserve(MAX_HITFIT_JET);
+    _lightJets.reserve(MAX_HITFIT_JET);
+    _jet_types.reserve(MAX_HITFIT_JET);
   }
 
   bpkRunHitFit::~bpkRunHitFit()
@@ -65,11 +264,23 @@ namespace hitfit{
 
   void bpkRunHitFit::clear()
   {
-    _event = Lepjets_Event(0,0);
+    // Keep the storage of the event and of the result lists,
+    // the next event refills them in place.
+    _event.clear();
     _jets.clear();
     _jetObjRes = false;
-    _Unfitted_Events.clear();
-    _Fit_Results.clear();
+    _Unfitted_Events.reset();
+    _Fit_Results.reset();
+    _Fit_Codes.reset();
+    _Fit_Candidates.reset();
+    for (size_t k = 0 ; k != _scanResults.size(); k++) {
+      _scanResults[k].reset();
+    }
+    for (size_t v = 0 ; v != _jesResults.size(); v++) {
+      _jesResults[v].reset();
+    }
+    _ttbarResults.reset();
+    _ttbarCodes.reset();
   }
 
   void bpkRunHitFit::AddLepton(const LepInfoBranches& leptons,
@@ -121,14 +332,7 @@ namespace hitfit{
     return _TopGluon_Fit;
   }
 
-/*
-  const Top_Fit& bpkRunHitFit::GetTopFit() const
-  {
-    return _Top_Fit;
-  }
-  */
-
-  std::vector<Fit_Result>::size_type bpkRunHitFit::FitAllPermutation(const JetInfoBranches& jet, std::vector<bool> jetisbtag)
+  std::vector<Fit_Result>::size_type bpkRunHitFit::FitAllPermutation(const JetInfoBranches& jet, const std::vector<bool>& jetisbtag)
   {
     if (_jets.size() < MIN_HITFIT_JET) {
       // For ttbar lepton+jets, a minimum of MIN_HITFIT_JETS jets
@@ -142,144 +346,1347 @@ namespace hitfit{
       return 0;
     }
 
-    _Unfitted_Events.clear();
-    _Fit_Results.clear();
+    _jetInputs.clear();
+    for (size_t j = 0 ; j != _jets.size(); j++) {
+      _jetInputs.push_back(bpkHitFitInput::MakeJet(jet,_jets[j],jetisbtag[_jets[j]]));
+    }
+
+    return FitPermutations();
 
-    // Prepare the array of jet types for permutation
-    std::vector<int> jet_types (_jets.size(), unknown_label);
-    jet_types[0] = lepb_label;
-    jet_types[1] = hadb_label;
-    jet_types[2] = hadw1_label;
-    jet_types[3] = hadw1_label;
+  }
 
-    jet_types[4] = gluon1_label;
-    jet_types[5] = gluon2_label;
+  std::vector<Fit_Result>::size_type bpkRunHitFit::FitEvent(const bpkHitFitInput& input, bool useObjRes)
+  {
+    clear();
 
-    std::stable_sort(jet_types.begin(),jet_types.end());
+    _event.runnum() = input.runnum;
+    _event.evnum()  = input.evnum;
 
-    const int nustart = (_nu_solution==1) ? _nu_solution : 0;//
+    for (size_t i = 0 ; i != input.leptons.size(); i++) {
+      _event.add_lep(_LeptonTranslator(input.leptons[i],lepton_label,useObjRes));
+    }
+
+    _event.met()    = _METTranslator(input,useObjRes);
+    _event.kt_res() = _METTranslator.KtResolution(input,useObjRes);
+
+    _jetObjRes = useObjRes;
+    _jetInputs.clear();
+    for (size_t j = 0 ; j != input.jets.size() && j != MAX_HITFIT_JET; j++) {
+      _jets.push_back(j);
+      _jetInputs.push_back(input.jets[j]);
+    }
+
+    if (_jets.size() < MIN_HITFIT_JET) {
+      return 0;
+    }
+
+    return FitPermutations();
+  }
+
+  void bpkRunHitFit::TranslateJets(JetTranslator& translator)
+  {
+    // Translate every jet once per event for each of the two
+    // jet energy corrections (b or light) it may receive.
+    _bJets.clear();
+    _lightJets.clear();
+    for (size_t j = 0 ; j != _jetInputs.size(); j++) {
+      _bJets.push_back(translator(_jetInputs[j],hadb_label,_jetObjRes));
+      _lightJets.push_back(translator(_jetInputs[j],unknown_label,_jetObjRes));
+    }
 
-    int Npermutation_ = 0;
-    int NpermutationB4Reduced_ = 0;
+    if (UsePreRankScores()) BuildMassTables();
+  }
+
+  bool bpkRunHitFit::UseTopGluonMassWindow() const
+  {
+    return _tgMassMax > 0;
+  }
 
-	// Find out the max number of btagged jets
-	int Nbtag_jets = 0;
-    int jet_size_ = _jets.size();
-	for(int i = 0; i < jet_size_; i ++){
-		//if(jet.CombinedSVBJetTags[_jets[i]] > 0.679) Nbtag_jets++;
-		if(jetisbtag[_jets[i]]) Nbtag_jets++;
+  void bpkRunHitFit::BuildMassTables()
+  {
+    // The hadronic top of every permutation is one triplet.
+    const size_t n = _bJets.size();
+    _bLightPairs.resize(n*n);
+    _hadTriplets.resize(n*n*n);
+    for (size_t j = 0 ; j != n; j++) {
+      for (size_t k = 0 ; k != n; k++) {
+	_bLightPairs[j*n+k] = _bJets[j].p() + _lightJets[k].p();
+	for (size_t l = k+1 ; l < n; l++) {
+	  _hadTriplets[(j*n+k)*n+l] = _bLightPairs[j*n+k] + _lightJets[l].p();
 	}
-	//std::cout << "Number of btag jets : " << Nbtag_jets << std::endl;
+      }
+    }
+  }
+
+  template <class Fit>
+  Decay_Masses bpkRunHitFit::PreparedMasses(const Fit& fitter, const Lepjets_Event& fev) const
+  {
+    if (UseSinglePrecision()) return Lepjets_Event_Sums::decay_masses(fev);
+    return fitter.masses();
+  }
+
+  bool bpkRunHitFit::PassTopGluonMassWindow(const std::vector<int>& jet_types,
+					    const Decay_Masses& m) const
+  {
+    if (std::find(jet_types.begin(),jet_types.end(),gluon1_label) == jet_types.end() ||
+	std::find(jet_types.begin(),jet_types.end(),gluon2_label) == jet_types.end()) return true;
+
+    if (m.tg_lep < _tgMassMin || m.tg_lep > _tgMassMax) return false;
+    if (m.tg_had < _tgMassMin || m.tg_had > _tgMassMax) return false;
+    if (_tgEqualSideTolerance > 0 && std::fabs(m.tg_lep - m.tg_had) > _tgEqualSideTolerance) return false;
+    return true;
+  }
+
+  void bpkRunHitFit::SetTopGluonMassWindow(double mass_min, double mass_max,
+					   double equal_side_tolerance)
+  {
+    _tgMassMin = mass_min;
+    _tgMassMax = mass_max;
+    _tgEqualSideTolerance = equal_side_tolerance;
+  }
+
+  bool bpkRunHitFit::UsePreRank() const
+  {
+    return _preRankTopN > 0 || _preRankDelta > 0;
+  }
+
+  bool bpkRunHitFit::UsePreRankScores() const
+  {
+    return UsePreRank() || _preRankValidate;
+  }
+
+  double bpkRunHitFit::PreRankScore(const std::vector<int>& jet_types) const
+  {
+    const size_t n = jet_types.size();
+    size_t lepb = n, hadb = n, w1 = n, w2 = n;
+    double score = 0;
+    for (size_t j = 0 ; j != n; j++) {
+      switch (jet_types[j]) {
+      case lepb_label:   lepb = j; break;
+      case hadb_label:   hadb = j; break;
+      case hadw1_label:
+      case hadw2_label:  if (w1 == n) w1 = j; else w2 = j; break;
+      }
+      // b-tag agreement; the b slots are covered by FindPermutations()
+      if (((_btagMask.tagged >> j) & 1) && !IsBJetType(jet_types[j])) score += PRERANK_BTAG;
+      // pT ordering: the jets outside the hypothesis slots (ISR) are
+      // expected to be the softest
+      if (IsExtraJetType(jet_types[j])) {
+	double pt = _lightJets[j].p().perp();
+	for (size_t k = 0 ; k != n; k++) {
+	  if (!IsExtraJetType(jet_types[k]) && _lightJets[k].p().perp() < pt) score += PRERANK_PT_ORDER;
+	}
+      }
+    }
+    if (lepb == n || hadb == n || w2 == n) return score;
+
+    if (_hadw_mass > 0) {
+      double dw = ((_lightJets[w1].p() + _lightJets[w2].p()).m() - _hadw_mass) / PRERANK_SIGMA_W;
+      score += dw*dw;
+    }
+
+    // Leptonic top with the better of the two neutrino solutions
+    double mthad = _hadTriplets[(hadb*n+w1)*n+w2].m();
+    double dt = 1e30;
+    for (int nusol = 0 ; nusol != 2; nusol++) {
+      double d = std::fabs((_lepnu[nusol] + _bJets[lepb].p()).m() - mthad);
+      if (d < dt) dt = d;
+    }
+    dt /= PRERANK_SIGMA_TOP;
+    return score + dt*dt;
+  }
+
+  void bpkRunHitFit::SelectCandidates()
+  {
+    const size_t n = _candidates.size();
+    _candidateSelected.assign(n, 1);
+    if (!UsePreRankScores() || n == 0) return;
+
+    // Lepton + neutrino, with the neutrino pz from the W mass; does
+    // not depend on the jets.
+    double nuz1 = 0, nuz2 = 0;
+    Top_Decaykin::solve_nu(_event, _lepw_mass > 0 ? _lepw_mass : 80.4, nuz1, nuz2);
+    for (int nusol = 0 ; nusol != 2; nusol++) {
+      Fourvec nu = _event.met();
+      nu.setZ(nusol ? nuz2 : nuz1);
+      adjust_e_for_mass(nu, 0);
+      _lepnu[nusol] = nu;
+      for (size_t i = 0 ; i != _event.nleps(); i++) _lepnu[nusol] += _event.lep(i).p();
+    }
+
+    _candidateScores.resize(n);
+    _candidateOrder.resize(n);
+    _candidateRank.resize(n);
+    for (size_t p = 0 ; p != n; p++) {
+      _candidateScores[p] = PreRankScore(_candidates[p]);
+      _candidateOrder[p] = p;
+    }
+    std::sort(_candidateOrder.begin(), _candidateOrder.end(), ScoreOrder(_candidateScores));
+
+    size_t nfit = n;
+    if (_preRankTopN > 0 && size_t(_preRankTopN) < nfit) nfit = _preRankTopN;
+    const double best = _candidateScores[_candidateOrder[0]];
+    for (size_t r = 0 ; r != n; r++) {
+      int p = _candidateOrder[r];
+      _candidateRank[p] = r;
+      if (_preRankDelta > 0 && r < nfit && _candidateScores[p] > best + _preRankDelta) nfit = r;
+    }
+
+    if (_preRankValidate) return;
+    for (size_t p = 0 ; p != n; p++) {
+      _candidateSelected[p] = size_t(_candidateRank[p]) < nfit;
+    }
+    _counters.prerank_skipped += n - nfit;
+  }
+
+  void bpkRunHitFit::SetPreRank(int top_n, double delta, bool validate)
+  {
+    _preRankTopN = top_n;
+    _preRankDelta = delta;
+    _preRankValidate = validate;
+  }
+
+  const bpkRunHitFitCounters& bpkRunHitFit::Counters() const
+  {
+    return _counters;
+  }
+
+  void bpkRunHitFit::ResetCounters()
+  {
+    _counters = bpkRunHitFitCounters();
+  }
+
+  void bpkRunHitFit::SetBTagPolicy(const bpkHitFitBTagPolicy& policy)
+  {
+    _btagPolicy = policy;
+  }
+
+  const bpkHitFitBTagPolicy& bpkRunHitFit::GetBTagPolicy() const
+  {
+    return _btagPolicy;
+  }
+
+  const bpkRunHitFit::PermutationTable& bpkRunHitFit::GetPermutationTable(size_t njets)
+  {
+    if (_permTables.size() <= njets) _permTables.resize(njets + 1);
+    PermutationTable& table = _permTables[njets];
+    if (!table.jet_types.empty()) return table;
+
+    // The slots of the t+g hypothesis fitted by _TopGluon_Fit, the
+    // other jets unknown
+    std::vector<int> jet_types(njets, unknown_label);
+    std::copy(TopGluon_Hypothesis::slots, TopGluon_Hypothesis::slots + TopGluon_Hypothesis::njets,
+	      jet_types.begin());
+    std::stable_sort(jet_types.begin(),jet_types.end());
+
     do {
-      NpermutationB4Reduced_++;
-      // require at least one bjet
-      bool EventWithAtLeastOneBtagJet = false;
-      int Nbtag_ = 0;
-      for (int j = 0 ; j != jet_size_; j++) {
-		if(jet_types[j] == lepb_label || jet_types[j] == hadb_label){
-      	  //if(jet.CombinedSVBJetTags[_jets[j]] > 0.679){
-      	  if(jetisbtag[_jets[j]]){
-				EventWithAtLeastOneBtagJet = true;
-		  		Nbtag_++;
-		  }
-	    }
-      }
-      if(Nbtag_jets <= 1) if(!EventWithAtLeastOneBtagJet) continue;
-	  if(Nbtag_jets > 1) if(Nbtag_ < 2) continue;
-	  //if(!EventWithAtLeastOneBtagJet) continue;
-      //if(Nbtag_!=2) continue;	// require 2 bjets
-
-/*
-      bool GluonWithoutPassingBtag = true;
-      for (int j = 0 ; j != jet_size_; j++) {
-	if(jet_types[j] == gluon1_label || jet_types[j] == gluon2_label){
-          if(jet.CombinedSVBJetTags[_jets[j]] > 0.679) GluonWithoutPassingBtag = false;
+      unsigned bslots = 0, gslots = 0;
+      for (size_t j = 0 ; j != njets; j++) {
+	if (jet_types[j] == lepb_label || jet_types[j] == hadb_label) bslots |= 1u << j;
+	if (jet_types[j] == gluon1_label || jet_types[j] == gluon2_label) gslots |= 1u << j;
+      }
+      table.jet_types.push_back(jet_types);
+      table.bslots.push_back(bslots);
+      table.gslots.push_back(gslots);
+    } while (std::next_permutation (jet_types.begin(), jet_types.end()));
+
+    return table;
+  }
+
+  void bpkRunHitFit::FindPermutations()
+  {
+    _candidates.reset();
+    _btagMask = _btagPolicy.Compile(_jetInputs);
+
+    const size_t njets = _jets.size();
+    if (njets < size_t(TopGluon_Hypothesis::njets)) return;
+
+    // The b-tag requirement of the event against the slots of
+    // each permutation
+    const PermutationTable& table = GetPermutationTable(njets);
+    for (size_t k = 0 ; k != table.jet_types.size(); k++) {
+      if (!_btagMask.Accept(table.bslots[k],table.gslots[k])) continue;
+      _candidates.push_back(table.jet_types[k]);
+    }
+
+    // Only with the event trace, as for TopGluon_Fit; fitter copies on
+    // other threads would interleave it otherwise.
+    if (_TopGluon_Fit.args().print_event_flag()) {
+      std::cout<<"reduced permutations (b4)  : "<<_candidates.size()<<" ( "<<table.jet_types.size()<<" ) ; _jets.size() : "<<njets
+      <<std::endl;
+    }
+  }
+
+  void bpkRunHitFit::BuildCompactSource(Lepjets_Event& source) const
+  {
+    // Each jet twice: the b translation of jet j as jet j, the light
+    // translation as jet n+j.
+    source = _event;
+    for (size_t j = 0 ; j != _bJets.size(); j++) {
+      source.add_jet(_bJets[j]);
+    }
+    for (size_t j = 0 ; j != _lightJets.size(); j++) {
+      source.add_jet(_lightJets[j]);
+    }
+  }
+
+  void bpkRunHitFit::BuildCompact(const std::vector<int>& jet_types,
+				  const Lepjets_Event& source,
+				  Compact_Event& c) const
+  {
+    // The jets were translated by TranslateJets() before the loop,
+    // with jet energy correction applied for both the b and the light
+    // jet hypothesis; pick the one in accord with the assumed jet type.
+    const size_t n = jet_types.size();
+    c.reset(source);
+    for (size_t i = 0 ; i != source.nleps(); i++) {
+      c.add_lep(source,i);
+    }
+    for (size_t j = 0 ; j != n; j++) {
+      c.add_jet(source,IsBJetType(jet_types[j]) ? j : n+j, jet_types[j]);
+    }
+    c.set_jet_types(jet_types);
+  }
+
+  void bpkRunHitFit::BuildEvent(const std::vector<int>& jet_types,
+				const Lepjets_Event& source)
+  {
+    // As the original loop: the event with the translated jets of the
+    // permutation.  The objects are only copied, resolution and all,
+    // where the b or light translation of a jet changes; otherwise the
+    // momenta, changed by the last fit, are reset.
+    Lepjets_Event& ev = _builtEv;
+    const size_t n = jet_types.size();
+    if (!_builtValid || ev.njets() != n || ev.nleps() != source.nleps()) {
+      ev.clear(source.runnum(), source.evnum());
+      ev.kt_res() = source.kt_res();
+      ev.zvertex() = source.zvertex();
+      ev.setMC(source.isMC());
+      ev.dlb() = source.dlb();
+      ev.dnn() = source.dnn();
+      for (size_t i = 0 ; i != source.nleps(); i++) {
+	ev.add_lep(source.lep(i));
+      }
+      _builtSrc.resize(n);
+      for (size_t j = 0 ; j != n; j++) {
+	_builtSrc[j] = IsBJetType(jet_types[j]) ? j : n+j;
+	ev.add_jet(source.jet(_builtSrc[j]));
+      }
+      _builtValid = true;
+    } else {
+      for (size_t i = 0 ; i != source.nleps(); i++) {
+	ev.lep(i).p() = source.lep(i).p();
+      }
+      for (size_t j = 0 ; j != n; j++) {
+	const size_t k = IsBJetType(jet_types[j]) ? j : n+j;
+	if (size_t(_builtSrc[j]) != k) {
+	  ev.jet(j) = source.jet(k);
+	  _builtSrc[j] = k;
+	} else {
+	  ev.jet(j).p() = source.jet(k).p();
+	}
+      }
+    }
+    ev.met() = source.met();
+    ev.set_jet_types(jet_types);
+  }
+
+  void bpkRunHitFit::ResetResults()
+  {
+    _Unfitted_Events.reset();
+    _Fit_Results.reset();
+    _Fit_Codes.reset();
+    _Fit_Candidates.reset();
+    _Fit_Degenerate.reset();
+    _preparedEvents.reset();
+    _prepared.reset();
+    for (size_t k = 0 ; k != _scanResults.size(); k++) {
+      _scanResults[k].reset();
+    }
+    for (size_t v = 0 ; v != _jesResults.size(); v++) {
+      _jesResults[v].reset();
+    }
+    _ttbarResults.reset();
+    _ttbarCodes.reset();
+    _pullHolders.clear();
+    _nuzValid = false;
+    _builtValid = false;
+  }
+
+  std::vector<Fit_Result>::size_type bpkRunHitFit::FitPermutations()
+  {
+    if (!_allocAudit) return FitJetPermutations();
+
+    const bpkHitFitAllocCount a0 = bpkHitFitAllocCount::Now();
+    const long peak0 = bpkHitFitPeakRSS();
+    _loopAlloc.allocs = 0;
+    _loopAlloc.bytes  = 0;
+
+    std::vector<Fit_Result>::size_type n = FitJetPermutations();
+
+    const bpkHitFitAllocCount a1 = bpkHitFitAllocCount::Now();
+    const size_t njets = _jetInputs.size();
+    if (_alloc.by_njets.size() <= njets) _alloc.by_njets.resize(njets + 1);
+    bpkHitFitAllocAudit::Multiplicity& m = _alloc.by_njets[njets];
+    m.events++;
+    m.allocs          += a1.allocs - a0.allocs;
+    m.bytes           += a1.bytes - a0.bytes;
+    m.loop_allocs     += _loopAlloc.allocs;
+    m.loop_bytes      += _loopAlloc.bytes;
+    m.peak_rss_growth += bpkHitFitPeakRSS() - peak0;
+    m.max_rss          = std::max(m.max_rss, bpkHitFitCurrentRSS());
+
+    _alloc.last_allocs      = a1.allocs - a0.allocs;
+    _alloc.last_bytes       = a1.bytes - a0.bytes;
+    _alloc.last_loop_allocs = _loopAlloc.allocs;
+    _alloc.last_loop_bytes  = _loopAlloc.bytes;
+
+    // The buffers have their size once an event at least as large went through.
+    if (njets <= _allocWarmJets && _Fit_Results.size() <= _allocWarmResults) {
+      _alloc.steady_events++;
+      _alloc.steady_loop_allocs += _loopAlloc.allocs;
+    }
+    _allocWarmJets    = std::max(_allocWarmJets, njets);
+    _allocWarmResults = std::max(_allocWarmResults, size_t(_Fit_Results.size()));
+
+    return n;
+  }
+
+  std::vector<Fit_Result>::size_type bpkRunHitFit::FitJetPermutations()
+  {
+    ResetResults();
+
+    _counters.events++;
+    AttachPerf();
+    if (_usePerf) _perf.CountEvent();
+
+    bpkHitFitCacheKey key;
+    if (UseCache()) {
+      key = bpkHitFitCacheKey(_event.runnum(),_event.evnum(),InputHash(),ConfigHash());
+      if (_cache->Find(key,_cachePayload)) {
+	// The results refer to the translated jets.
+	TranslateJets(_JetTranslator);
+	BuildCompactSource(_compactSource);
+	if (LoadResults(_cachePayload)) {
+	  _counters.cache_hits++;
+	  return _Fit_Results.size();
 	}
+	ResetResults();
       }
-      */
-      //if(!GluonWithoutPassingBtag) continue;
-
-      Npermutation_++;
-      // begin loop over all jet permutation
-      for (int nusol = nustart ; nusol != 2 ; nusol++) {
-    if(nusol > _nu_solution) break;
-	// loop over two neutrino solution
-	bool nuz = bool(nusol);
-
-	// Copy the event
-	Lepjets_Event fev = _event;
-
-	// Add jets into the event, with the assumed type
-	// in accord with the permutation.
-	// The translator _JetTranslator will correctly
-	// return object of Lepjets_Event_Jet with
-	// jet energy correction applied in accord with
-	// the assumed jet type (b or light).
-	for (size_t j = 0 ; j != _jets.size(); j++) {
-	  fev.add_jet(_JetTranslator(jet,_jets[j],jet_types[j],_jetObjRes));
+      _counters.cache_misses++;
+    }
+
+    // The b-tag selection of the permutations only depends on
+    // which jets are tagged; it is shared by all fits below.
+    FindPermutations();
+
+    bpkHitFitPerf::Sample s0, s1;
+    if (_usePerf) _perf.Take(s0);
+    TranslateJets(_JetTranslator);
+    BuildCompactSource(_compactSource);
+    if (UseSinglePrecision()) _scalarSource.assign(_compactSource);
+    if (_usePerf) {
+      _perf.Take(s1);
+      _perf.Add(bpkHitFitPerf::translation,s0,s1);
+    }
+    SelectCandidates();
+
+    // With the two-stage fit the permutations are first fitted with
+    // the coarse fitter, and only the leading ones refitted in full.
+    TopGluon_Fit& fitter = UseTwoStage() ? _coarseFit[0] : _TopGluon_Fit;
+    bpkHitFitAllocCount l0;
+    if (_allocAudit) l0 = LoopAllocCount();
+    for (size_t p = 0 ; p != _candidates.size(); p++) {
+      if (!_candidateSelected[p]) continue;
+      FitPermutation(p,fitter);
+    }
+    if (_allocAudit) {
+      const bpkHitFitAllocCount l1 = LoopAllocCount();
+      _loopAlloc.allocs = l1.allocs - l0.allocs;
+      _loopAlloc.bytes  = l1.bytes - l0.bytes;
+    }
+
+    if (UseTwoStage()) RefineFits();
+    if (UseLazyPulls()) RefitPulls();
+
+    // Fit the other top mass hypotheses
+    for (size_t i = 0 ; !_scanFits.empty() && i != _Fit_Results.size(); i++) {
+      FitScan(i);
+    }
+
+    if (_preRankValidate) {
+      int best = BestFit(_Fit_Results,_Fit_Codes);
+      if (best >= 0 && size_t(_Fit_Candidates[best]) < _candidateRank.size()) {
+	size_t best_rank = _candidateRank[_Fit_Candidates[best]];
+	_counters.prerank_validated++;
+	if (_counters.prerank_best_rank.size() <= best_rank) {
+	  _counters.prerank_best_rank.resize(best_rank + 1, 0);
 	}
+	_counters.prerank_best_rank[best_rank]++;
+      }
+    }
+
+    // The ttbar interpretation, from the same translated jets
+    if (UseTTbarFit()) {
+      unsigned long fits = _counters.fits;
+      FindTTbarPermutations();
+      for (size_t p = 0 ; p != _ttbarCandidates.size(); p++) {
+	FitVariation(_ttbarCandidates[p],_compactSource,_ttbarFit[0],_ttbarResults,&_ttbarCodes);
+      }
+      _counters.ttbar_fits += _counters.fits - fits;
+    }
 
-	// Clone fev (intended to be fitted event)
-	// to ufev (intended to be unfitted event)
-	Lepjets_Event ufev = fev;
+    // Refit the same permutations with the jet energy scale variations
+    for (size_t v = 0 ; v != _jesTranslators.size(); v++) {
+      TranslateJets(_jesTranslators[v]);
+      BuildCompactSource(_jesSources[v]);
+      _builtValid = false;
+      if (UseSinglePrecision()) _scalarSource.assign(_jesSources[v]);
+      for (size_t p = 0 ; p != _candidates.size(); p++) {
+	if (!_candidateSelected[p]) continue;
+	FitVariation(_candidates[p],_jesSources[v],_TopGluon_Fit,_jesResults[v]);
+      }
+    }
+
+    if (UseCache()) {
+      StoreResults(_cachePayload);
+      _cache->Store(key,_cachePayload);
+    }
 
-	// Set jet types.
-	fev.set_jet_types(jet_types);
-	ufev.set_jet_types(jet_types);
+    return _Fit_Results.size();
+
+  }
+
+  void bpkRunHitFit::FitPermutation(int p, TopGluon_Fit& fitter)
+  {
+    const std::vector<int>& jet_types = _candidates[p];
+
+    // Build the event and solve for the neutrino once; the two
+    // solutions only differ in the neutrino pz.
+    BuildEvent(jet_types,_compactSource);
+    BuildCompact(jet_types,_compactSource,_builtCompact);
+    double umwhad, umthad, nuz[2];
+    SolvePermutation(fitter,umwhad,umthad,nuz);
+
+    // loop over two neutrino solution
+    const int nustart = (_nu_solution==1) ? _nu_solution : 0;//
+    for (int nusol = nustart ; nusol != 2 ; nusol++) {
+      if(nusol > _nu_solution) break;
+      _counters.permutations++;
+      _Fit_Candidates.push_back(p);
+      _Fit_Codes.push_back(PermutationCode(jet_types,nusol));
+
+      // Complex solutions give the same pz twice, and the same fit.
+      bool degenerate = nusol != nustart && nuz[nusol] == nuz[nustart];
+      _Fit_Degenerate.push_back(degenerate);
+      if (degenerate) {
+	_counters.nu_degenerate++;
+	const size_t i = _Fit_Results.size();
+	CopyDegenerate(_Unfitted_Events,i);
+	CopyDegenerate(_Fit_Results,i);
+	if (KeepPrepared()) {
+	  CopyDegenerate(_preparedEvents,i);
+	  CopyDegenerate(_prepared,i);
+	}
+	continue;
+      }
+
+      if (nusol != nustart) BuildEvent(jet_types,_compactSource);
+      FitSolution(jet_types,nuz[nusol],umwhad,umthad,fitter);
+    }
+  }
+
+  template <class Fit>
+  void bpkRunHitFit::SolvePermutation(Fit& fitter, double& umwhad, double& umthad, double nuz[2])
+  {
+    bpkHitFitPerf::Sample s0, s1;
+    if (_usePerf) _perf.Take(s0);
+    if (UseSinglePrecision()) {
+      _scalarKin.solve(_scalarSource,_builtCompact,_lepw_mass,umwhad,umthad,nuz[0],nuz[1]);
+    } else if (fitter.args().solve_nu_tmass()) {
+      fitter.solve_one_perm(_builtEv,umwhad,umthad,nuz[0],nuz[1]);
+    } else if (_nuzValid) {
+      // The W mass solutions only depend on the leptons and the MET.
+      fitter.sum_one_perm(_builtEv,umwhad,umthad);
+      nuz[0] = _eventNuz[0];
+      nuz[1] = _eventNuz[1];
+    } else {
+      fitter.solve_one_perm(_builtEv,umwhad,umthad,nuz[0],nuz[1]);
+      _eventNuz[0] = nuz[0];
+      _eventNuz[1] = nuz[1];
+      _nuzValid = true;
+    }
+    if (_usePerf) {
+      _perf.Take(s1);
+      _perf.Add(bpkHitFitPerf::neutrino_solve,s0,s1);
+    }
+  }
+
+  template <class Fit>
+  bool bpkRunHitFit::PrepareSolution(Fit& fitter, Lepjets_Event& fev, double nuz, double umwhad,
+				     double umthad, double& utmass)
+  {
+    // Accounted with the solve of the permutation, as one call.
+    bpkHitFitPerf::Sample s0, s1;
+    if (_usePerf) _perf.Take(s0);
+    bool ok;
+    if (UseSinglePrecision()) {
+      ok = _scalarKin.prepare(nuz,umwhad,umthad,_hadw_mass,fitter.args(),fev.met(),utmass);
+    } else {
+      ok = fitter.prepare_solved_perm(fev,nuz,umwhad,umthad,utmass);
+    }
+    if (_usePerf) {
+      _perf.Take(s1);
+      _perf.Add(bpkHitFitPerf::neutrino_solve,s0,s1,0);
+    }
+    return ok;
+  }
+
+  void bpkRunHitFit::SetPerfCounters(bool on)
+  {
+    _usePerf = on;
+  }
+
+  const bpkHitFitPerf& bpkRunHitFit::Perf() const
+  {
+    return _perf;
+  }
+
+  void bpkRunHitFit::ResetPerf()
+  {
+    _perf.Reset();
+  }
+
+  void bpkRunHitFit::SetAllocAudit(bool on)
+  {
+    _allocAudit = on;
+    if (on) _usePerf = true;
+  }
+
+  const bpkHitFitAllocAudit& bpkRunHitFit::AllocAudit() const
+  {
+    return _alloc;
+  }
+
+  void bpkRunHitFit::ResetAllocAudit()
+  {
+    // The buffers stay warm.
+    _alloc = bpkHitFitAllocAudit();
+  }
+
+  bpkHitFitAllocCount bpkRunHitFit::LoopAllocCount() const
+  {
+    bpkHitFitAllocCount c = bpkHitFitAllocCount::Now();
+    c.allocs -= _perf.Allocs(bpkHitFitPerf::import_export) + _perf.Allocs(bpkHitFitPerf::constrainer);
+    c.bytes  -= _perf.AllocBytes(bpkHitFitPerf::import_export) + _perf.AllocBytes(bpkHitFitPerf::constrainer);
+    return c;
+  }
+
+  void bpkRunHitFit::AttachPerf()
+  {
+    bpkHitFitPerf* perf = _usePerf ? &_perf : 0;
+    _TopGluon_Fit.set_perf(perf);
+    for (size_t i = 0 ; i != _coarseFit.size(); i++) _coarseFit[i].set_perf(perf);
+    for (size_t k = 0 ; k != _scanFits.size(); k++) _scanFits[k].set_perf(perf);
+    for (size_t i = 0 ; i != _ttbarFit.size(); i++) _ttbarFit[i].set_perf(perf);
+  }
+
+  void bpkRunHitFit::SetSinglePrecision(bool on)
+  {
+    _singlePrecision = on;
+  }
+
+  bool bpkRunHitFit::UseSinglePrecision() const
+  {
+    return _singlePrecision && !_TopGluon_Fit.args().solve_nu_tmass();
+  }
+
+  template <class Vector>
+  void bpkRunHitFit::CopyDegenerate(Vector& v, size_t i)
+  {
+    if (i == v.size()) v.push_back(v[i-1]);
+    else               v[i] = v[i-1];
+  }
+
+  void bpkRunHitFit::FitSolution(const std::vector<int>& jet_types, double nuz,
+				 double umwhad, double umthad, TopGluon_Fit& fitter)
+  {
+	// Fitted in place; the caller rebuilds it between the two
+	// neutrino solutions.
+	Lepjets_Event& fev = _builtEv;
 
 	// Store the unfitted event
-	_Unfitted_Events.push_back(ufev);
+	_Unfitted_Events.push_back(_builtCompact);
 
 	// Prepare the placeholder for various kinematic quantities
-	double umwhad;
 	double utmass;
-	double mt;
-	double sigmt;
-	Column_Vector pullx;
-	Column_Vector pully;
-
-	// Do the fit
-	double chisq= _TopGluon_Fit.fit_one_perm(fev,
-	//double chisq= _Top_Fit.fit_one_perm(fev,
-					    nuz,
-					    umwhad,
-					    utmass,
-					    mt,
-					    sigmt,
-					    pullx,
-					    pully);
+	double mt = 0;
+	double sigmt = 0;
+	Column_Vector& pullx = _pullx;
+	Column_Vector& pully = _pully;
+
+	// Do the fit; same as TopGluon_Fit::fit_one_perm, keeping the
+	// prepared event for the refit and the fits of the other mass
+	// points and checking the t+g mass window in between
+	double chisq = -999;
+	bool prepared = PrepareSolution(fitter,fev,nuz,umwhad,umthad,utmass);
+	if (prepared && UseTopGluonMassWindow() && !PassTopGluonMassWindow(jet_types,PreparedMasses(fitter,fev))) {
+	  prepared = false;
+	  _counters.tg_mass_pruned++;
+	  _counters.tg_fits_saved += 1 + _scanFits.size();
+	}
+	if (KeepPrepared()) {
+	  // Only the neutrino differs from the unfitted event
+	  _preparedEvents.push_back(_builtCompact);
+	  _preparedEvents.back().met() = fev.met();
+	  _prepared.push_back(prepared);
+	}
+	if (prepared) {
+	  chisq = fitter.constrain_one_perm(fev,mt,sigmt,pullx,pully);
+	  _counters.fits++;
+	} else {
+	  pullx = Column_Vector();
+	  pully = Column_Vector();
+	}
 
 	//std::cout<<"mt "<<mt<<" utmass "<<utmass<<std::endl;
-	// Store output of the fit
-	_Fit_Results.push_back(Fit_Result(chisq,
-					  fev,
-					  pullx,
-					  pully,
-					  umwhad,
-					  utmass,
-					  mt,
-					  sigmt));
-
-      } // end loop over two neutrino solution
+	// Store output of the fit; lazy pulls are set by RefitPulls()
+	const bool lazy = UseLazyPulls();
+	_Fit_Results.extend().assign(chisq,
+				     _builtCompact,
+				     fev,
+				     lazy ? _noPulls : pullx,
+				     lazy ? _noPulls : pully,
+				     umwhad,
+				     utmass,
+				     mt,
+				     sigmt);
+  }
 
-    } while (std::next_permutation (jet_types.begin(), jet_types.end()));
-    // end loop over all jet permutations
+  void bpkRunHitFit::FitScan(std::vector<Fit_Result>::size_type i)
+  {
+    if (_Fit_Degenerate[i]) {
+      for (size_t k = 0 ; k != _scanFits.size(); k++) {
+	CopyDegenerate(_scanResults[k],i);
+      }
+      return;
+    }
 
-    std::cout<<"reduced permutations (b4)  : "<<Npermutation_<<" ( "<<NpermutationB4Reduced_<<" ) ; _jets.size() : "<<_jets.size()
-    <<std::endl;
+    // Permutations left with their coarse fit are not scanned.
+    const Compact_Fit_Result& nominal = _Fit_Results[i];
+    bool fit = _prepared[i] && (!UseTwoStage() || _refined[i]);
+    const Compact_Event& prepared = _preparedEvents[i];
+    if (fit) prepared.to_event(_compactSource,_scanEv);
+    for (size_t k = 0 ; k != _scanFits.size(); k++) {
+      double smt = 0;
+      double ssigmt = 0;
+      double schisq = -999;
+      if (fit) {
+	// Only the momenta change in a fit.
+	if (k) prepared.restore_momenta(_scanEv);
+	schisq = _scanFits[k].constrain_one_perm(_scanEv,smt,ssigmt,_pullx,_pully);
+	_counters.fits++;
+      } else {
+	_pullx = Column_Vector();
+	_pully = Column_Vector();
+      }
+      _scanResults[k].extend().assign(schisq,
+				      prepared,
+				      _scanEv,
+				      _pullx,
+				      _pully,
+				      nominal.umwhad(),
+				      nominal.utmass(),
+				      smt,
+				      ssigmt);
+    }
+  }
 
-    return _Fit_Results.size();
+  void bpkRunHitFit::FullFit(std::vector<Fit_Result>::size_type i, Compact_Fit_Result& full)
+  {
+    const Compact_Fit_Result& coarse = _Fit_Results[i];
+    double mt = 0;
+    double sigmt = 0;
+    _preparedEvents[i].to_event(_compactSource,_fev);
+    double chisq = _TopGluon_Fit.constrain_one_perm(_fev,mt,sigmt,_pullx,_pully);
+    _counters.fits++;
+    const bool lazy = UseLazyPulls();
+    full.assign(chisq,_preparedEvents[i],_fev,
+		lazy ? _noPulls : _pullx,lazy ? _noPulls : _pully,
+		coarse.umwhad(),coarse.utmass(),mt,sigmt);
+  }
+
+  void bpkRunHitFit::RefineFits()
+  {
+    const size_t n = _Fit_Results.size();
+    _refined.assign(n, 0);
+
+    int leader = BestFit(_Fit_Results,_Fit_Codes);
+    double cut = leader >= 0 ? _Fit_Results[leader].chisq() + _twoStageMargin : -1;
+
+    // In validation mode, keep the full fits of all permutations
+    // to compare the rankings.
+    if (_twoStageValidate) _fullResults.reset();
+
+    for (size_t i = 0 ; i != n; i++) {
+      if (_Fit_Degenerate[i]) {
+	CopyDegenerate(_Fit_Results,i);
+	CopyDegenerate(_refined,i);
+	if (_twoStageValidate) CopyDegenerate(_fullResults,i);
+	continue;
+      }
+      if (!_prepared[i]) {
+	if (_twoStageValidate) _fullResults.push_back(_Fit_Results[i]);
+	continue;
+      }
+      // A coarse fit cut off by its iteration limit says nothing about
+      // the full one, it is refitted whatever the margin.
+      double chisq = _Fit_Results[i].chisq();
+      bool unconverged = chisq < 0;
+      bool refine = unconverged || chisq <= cut;
+      if (unconverged) _counters.twostage_unconverged++;
+      else if (!refine) _counters.twostage_outside_margin++;
+      if (refine || _twoStageValidate) {
+	Compact_Fit_Result& full = _fullResult;
+	FullFit(i,full);
+	if (_twoStageValidate) _fullResults.push_back(full);
+	if (refine) {
+	  _Fit_Results[i] = full;
+	  _refined[i] = 1;
+	  _counters.twostage_refined++;
+	}
+      }
+    }
+
+    if (_twoStageValidate) {
+      int best = BestFit(_fullResults,_Fit_Codes);
+      if (best >= 0) {
+	_counters.twostage_validated++;
+	if (_refined[best]) _counters.twostage_best_refined++;
+	if (BestFit(_Fit_Results,_Fit_Codes) == best) _counters.twostage_best_agree++;
+      }
+    }
+  }
 
+  void bpkRunHitFit::SetLazyPulls(int keep)
+  {
+    _lazyPulls = keep > 0 ? keep : 0;
+    _pullHolders.clear();
+    _pullHolders.reserve(_lazyPulls);
+  }
+
+  bool bpkRunHitFit::UseLazyPulls() const
+  {
+    return _lazyPulls > 0;
+  }
+
+  bool bpkRunHitFit::KeepPrepared() const
+  {
+    return UseTwoStage() || !_scanFits.empty() || UseLazyPulls();
+  }
+
+  void bpkRunHitFit::RefitPulls()
+  {
+    // The _lazyPulls best converged results, in the ranking of
+    // BestFit(); with the two-stage fit the refitted ones only.
+    _pullHolders.clear();
+    for (size_t i = 0 ; i != _Fit_Results.size(); i++) {
+      if (_Fit_Results[i].chisq() < 0) continue;
+      if (UseTwoStage() && !_refined[i]) continue;
+      if (int(_pullHolders.size()) < _lazyPulls) {
+	_pullHolders.push_back(i);
+	continue;
+      }
+      size_t worst = 0;
+      for (size_t k = 1 ; k != _pullHolders.size(); k++) {
+	if (RanksBefore(_Fit_Results,_Fit_Codes,_pullHolders[worst],_pullHolders[k])) worst = k;
+      }
+      if (RanksBefore(_Fit_Results,_Fit_Codes,i,_pullHolders[worst])) _pullHolders[worst] = i;
+    }
+    std::sort(_pullHolders.begin(),_pullHolders.end());
+
+    for (size_t k = 0 ; k != _pullHolders.size(); k++) {
+      const size_t i = _pullHolders[k];
+      // A degenerate copy takes the pulls of its original if that
+      // was refitted already.
+      if (_Fit_Degenerate[i] && _Fit_Results[i-1].pullx().num_row() != 0) {
+	_Fit_Results[i].set_pulls(_Fit_Results[i-1].pullx(),_Fit_Results[i-1].pully());
+	continue;
+      }
+      double mt = 0;
+      double sigmt = 0;
+      _preparedEvents[i].to_event(_compactSource,_fev);
+      _TopGluon_Fit.constrain_one_perm(_fev,mt,sigmt,_pullx,_pully);
+      _counters.fits++;
+      _counters.lazy_refits++;
+      _Fit_Results[i].set_pulls(_pullx,_pully);
+    }
+  }
+
+  void bpkRunHitFit::SetDeterministic(bool on)
+  {
+    _deterministic = on;
+  }
+
+  bool bpkRunHitFit::IsDeterministic() const
+  {
+    return _deterministic;
+  }
+
+  bool bpkRunHitFit::RanksBefore(const Scratch_Vector<Compact_Fit_Result>& results,
+				 const Scratch_Vector<int>& codes, int a, int b) const
+  {
+    const double ca = results[a].chisq();
+    const double cb = results[b].chisq();
+    if (ca != cb) return ca < cb;
+    if (_deterministic && codes[a] != codes[b]) return codes[a] < codes[b];
+    return a < b;
+  }
+
+  int bpkRunHitFit::BestFit(const Scratch_Vector<Compact_Fit_Result>& results,
+			    const Scratch_Vector<int>& codes) const
+  {
+    int best = -1;
+    for (size_t i = 0 ; i != results.size(); i++) {
+      if (results[i].chisq() < 0) continue;
+      if (best < 0 || RanksBefore(results,codes,i,best)) best = i;
+    }
+    return best;
+  }
+
+  void bpkRunHitFit::SetTwoStageFit(int maxit, double eps, double chi2_margin, bool validate)
+  {
+    _coarseFit.clear();
+    _twoStageMaxit = maxit;
+    _twoStageEps = eps;
+    _twoStageMargin = chi2_margin;
+    _twoStageValidate = validate;
+    if (maxit <= 0) return;
+
+    // Same settings as the full fitter, with the iteration limit and
+    // the convergence tolerances of the constrainer overridden.
+    std::ostringstream smaxit, seps1, seps2;
+    smaxit << "--maxit=" << maxit;
+    seps1  << "--chisq_diff_eps=" << eps;
+    seps2  << "--constraint_sum_eps=" << eps;
+    std::string args[4] = { "bpkRunHitFit", smaxit.str(), seps1.str(), seps2.str() };
+    char* argv[4];
+    for (int i = 0 ; i != 4; i++) argv[i] = const_cast<char*>(args[i].c_str());
+
+    _coarseFit.push_back(TopGluon_Fit(TopGluon_Fit_Args(Defaults_Text(_default_file,4,argv)),
+				      _lepw_mass,_hadw_mass,_top_mass));
+  }
+
+  bool bpkRunHitFit::UseTwoStage() const
+  {
+    return !_coarseFit.empty();
+  }
+
+  template <class Fit>
+  void bpkRunHitFit::FitVariation(const std::vector<int>& jet_types,
+				  const Lepjets_Event& source,
+				  Fit& fitter,
+				  Scratch_Vector<Compact_Fit_Result>& results,
+				  Scratch_Vector<int>* codes)
+  {
+    BuildEvent(jet_types,source);
+    BuildCompact(jet_types,source,_builtCompact);
+    double umwhad, umthad, nuz[2];
+    SolvePermutation(fitter,umwhad,umthad,nuz);
+
+    const int nustart = (_nu_solution==1) ? _nu_solution : 0;
+    for (int nusol = nustart ; nusol != 2 ; nusol++) {
+      if(nusol > _nu_solution) break;
+      _counters.permutations++;
+      if (codes) codes->push_back(PermutationCode(jet_types,nusol));
+      if (nusol != nustart && nuz[nusol] == nuz[nustart]) {
+	_counters.nu_degenerate++;
+	CopyDegenerate(results,results.size());
+	continue;
+      }
+
+      // Fitted in place, as in FitSolution()
+      if (nusol != nustart) BuildEvent(jet_types,source);
+      Lepjets_Event& fev = _builtEv;
+
+      double utmass;
+      double mt = 0;
+      double sigmt = 0;
+      double chisq = -999;
+      bool prepared = PrepareSolution(fitter,fev,nuz[nusol],umwhad,umthad,utmass);
+      if (prepared && UseTopGluonMassWindow() && !PassTopGluonMassWindow(jet_types,PreparedMasses(fitter,fev))) {
+	prepared = false;
+	_counters.tg_mass_pruned++;
+	_counters.tg_fits_saved++;
+      }
+      if (prepared) {
+	chisq = fitter.constrain_one_perm(fev,mt,sigmt,_pullx,_pully);
+	_counters.fits++;
+      } else {
+	_pullx = Column_Vector();
+	_pully = Column_Vector();
+      }
+
+      results.extend().assign(chisq,_builtCompact,fev,_pullx,_pully,umwhad,utmass,mt,sigmt);
+    }
+  }
+
+  bool bpkRunHitFit::UseTTbarFit() const
+  {
+    return !_ttbarFit.empty();
+  }
+
+  void bpkRunHitFit::SetTTbarFit(bool on)
+  {
+    _ttbarFit.clear();
+    if (!on) return;
+    _ttbarFit.push_back(TTbar_Fit(TopGluon_Fit_Args(Defaults_Text(_default_file)),
+				  _lepw_mass,_hadw_mass,_top_mass));
+  }
+
+  void bpkRunHitFit::FindTTbarPermutations()
+  {
+    _ttbarCandidates.reset();
+    _ttbarSeen.clear();
+
+    const size_t njets = _jets.size();
+    if (njets < size_t(TopGluon_Hypothesis::njets)) return;
+
+    // From all permutations, not the t+g candidates: a gluon veto of
+    // the b-tag policy has removed those with a tagged jet in a gluon
+    // slot, which is outside the ttbar slots.  Only the b slots count.
+    const PermutationTable& table = GetPermutationTable(njets);
+    for (size_t k = 0 ; k != table.jet_types.size(); k++) {
+      if (!_btagMask.Accept(table.bslots[k],0)) continue;
+      std::vector<int>& jet_types = _ttbarCandidates.extend();
+      jet_types = table.jet_types[k];
+      for (size_t j = 0 ; j != jet_types.size(); j++) {
+	if (!TTbar_Hypothesis::imported(jet_types[j])) jet_types[j] = isr_label;
+      }
+      int code = jetPermutationCode(jet_types);
+      std::vector<int>::iterator it = std::lower_bound(_ttbarSeen.begin(),_ttbarSeen.end(),code);
+      if (it != _ttbarSeen.end() && *it == code) {
+	_ttbarCandidates.pop_back();
+      } else {
+	_ttbarSeen.insert(it,code);
+      }
+    }
+  }
+
+  std::vector<Fit_Result>::size_type bpkRunHitFit::NumTTbarResults() const
+  {
+    return _ttbarResults.size();
+  }
+
+  const Fit_Result& bpkRunHitFit::GetTTbarResult(std::vector<Fit_Result>::size_type i) const
+  {
+    return MakeResult(_ttbarResults[i],_compactSource);
+  }
+
+  const Compact_Fit_Result& bpkRunHitFit::GetTTbarCompactResult(std::vector<Fit_Result>::size_type i) const
+  {
+    return _ttbarResults[i];
+  }
+
+  int bpkRunHitFit::GetTTbarPermutationCode(std::vector<Fit_Result>::size_type i) const
+  {
+    return _ttbarCodes[i];
+  }
+
+  int bpkRunHitFit::GetBestFit() const
+  {
+    return BestFit(_Fit_Results,_Fit_Codes);
+  }
+
+  int bpkRunHitFit::GetBestTTbarFit() const
+  {
+    return BestFit(_ttbarResults,_ttbarCodes);
+  }
+
+  void bpkRunHitFit::SetJESVariations(const std::vector< std::pair<double,double> >& variations)
+  {
+    _jesTranslators.clear();
+    _jesSources.clear();
+    _jesResults.clear();
+    for (size_t v = 0 ; v != variations.size(); v++) {
+      _jesTranslators.push_back(_JetTranslator);
+      _jesTranslators.back().SetJES(variations[v].first,variations[v].second);
+    }
+    _jesSources.resize(_jesTranslators.size(), Lepjets_Event(0,0));
+    _jesResults.resize(_jesTranslators.size());
+  }
+
+  std::vector<JetTranslator>::size_type bpkRunHitFit::NumJESVariations() const
+  {
+    return _jesTranslators.size();
+  }
+
+  const Fit_Result& bpkRunHitFit::GetJESResult(std::vector<JetTranslator>::size_type v,
+					       std::vector<Fit_Result>::size_type i) const
+  {
+    return MakeResult(_jesResults[v][i],_jesSources[v]);
+  }
+
+  std::vector<Fit_Result> bpkRunHitFit::GetJESFitAllPermutation(std::vector<JetTranslator>::size_type v)
+  {
+    std::vector<Fit_Result> results;
+    for (size_t i = 0 ; i != _jesResults[v].size(); i++) {
+      results.push_back(MakeResult(_jesResults[v][i],_jesSources[v]));
+    }
+    return results;
+  }
+
+  void bpkRunHitFit::SetTopMassScan(const std::vector<double>& top_masses)
+  {
+    _scanMasses = top_masses;
+    _scanFits.clear();
+    _scanResults.clear();
+    for (size_t k = 0 ; k != _scanMasses.size(); k++) {
+      _scanFits.push_back(TopGluon_Fit(_TopGluon_Fit.args(),_lepw_mass,_hadw_mass,_scanMasses[k]));
+    }
+    _scanResults.resize(_scanMasses.size());
+  }
+
+  std::vector<double>::size_type bpkRunHitFit::NumScanPoints() const
+  {
+    return _scanMasses.size();
+  }
+
+  double bpkRunHitFit::GetScanMass(std::vector<double>::size_type k) const
+  {
+    return _scanMasses[k];
+  }
+
+  const Fit_Result& bpkRunHitFit::GetScanResult(std::vector<double>::size_type k,
+						std::vector<Fit_Result>::size_type i) const
+  {
+    return MakeResult(_scanResults[k][i],_compactSource);
+  }
+
+  std::vector<Fit_Result> bpkRunHitFit::GetScanFitAllPermutation(std::vector<double>::size_type k)
+  {
+    std::vector<Fit_Result> results;
+    for (size_t i = 0 ; i != _scanResults[k].size(); i++) {
+      results.push_back(MakeResult(_scanResults[k][i],_compactSource));
+    }
+    return results;
+  }
+
+  void bpkRunHitFit::SetCache(bpkHitFitCache* cache, uint64_t extra_hash)
+  {
+    _cache = cache;
+    _cacheExtraHash = extra_hash;
+
+    std::ifstream in(_default_file.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    _defaultFileHash = bpkHitFitCache::Hash(contents.data(),contents.size());
+  }
+
+  bool bpkRunHitFit::UseCache() const
+  {
+    return _cache && _scanFits.empty() && _jesTranslators.empty() && !UseTTbarFit();
+  }
+
+  uint64_t bpkRunHitFit::ConfigHash() const
+  {
+    uint64_t h = HashValue(bpkHitFitCache::HASH_SEED,CACHE_FORMAT);
+    h = HashValue(h,_defaultFileHash);
+    h = HashValue(h,_cacheExtraHash);
+    h = HashValue(h,_lepw_mass);
+    h = HashValue(h,_hadw_mass);
+    h = HashValue(h,_top_mass);
+    h = HashValue(h,_nu_solution);
+    h = HashValue(h,_JetTranslator.jes());
+    h = HashValue(h,_JetTranslator.jesB());
+    h = _btagPolicy.Hash(h);
+    h = HashValue(h,_preRankTopN);
+    h = HashValue(h,_preRankDelta);
+    h = HashValue(h,_preRankValidate);
+    h = HashValue(h,_tgMassMin);
+    h = HashValue(h,_tgMassMax);
+    h = HashValue(h,_tgEqualSideTolerance);
+    if (UseTwoStage()) {
+      h = HashValue(h,_twoStageMaxit);
+      h = HashValue(h,_twoStageEps);
+      h = HashValue(h,_twoStageMargin);
+    }
+    if (UseSinglePrecision()) {
+      h = HashValue(h,int(sizeof(float)));
+    }
+    if (UseLazyPulls()) {
+      h = HashValue(h,_lazyPulls);
+    }
+    return h;
+  }
+
+  uint64_t bpkRunHitFit::InputHash() const
+  {
+    uint64_t h = bpkHitFitCache::HASH_SEED;
+    for (size_t i = 0 ; i != _event.nleps(); i++) {
+      const Fourvec& p = _event.lep(i).p();
+      h = HashValue(h,p.x());
+      h = HashValue(h,p.y());
+      h = HashValue(h,p.z());
+      h = HashValue(h,p.e());
+      h = HashValue(h,_event.lep(i).type());
+    }
+    h = HashValue(h,_event.met().x());
+    h = HashValue(h,_event.met().y());
+    // The MET resolution, per event or from SetKtResolution()
+    const Resolution& kt_res = _event.kt_res();
+    h = HashValue(h,kt_res.C());
+    h = HashValue(h,kt_res.R());
+    h = HashValue(h,kt_res.m());
+    h = HashValue(h,kt_res.N());
+    h = HashValue(h,kt_res.inverse());
+    h = HashValue(h,_jetObjRes);
+    for (size_t j = 0 ; j != _jetInputs.size(); j++) {
+      const bpkHitFitJet& jet = _jetInputs[j];
+      h = HashValue(h,jet.Px);
+      h = HashValue(h,jet.Py);
+      h = HashValue(h,jet.Pz);
+      h = HashValue(h,jet.Energy);
+      h = HashValue(h,jet.Eta);
+      h = HashValue(h,jet.Pt);
+      h = HashValue(h,jet.PtCorrL7b);
+      h = HashValue(h,jet.PtCorrL7uds);
+      h = HashValue(h,jet.PtCorrL3);
+      h = HashValue(h,jet.BTagDiscr);
+      h = HashValue(h,jet.isBTag);
+    }
+    return h;
+  }
+
+  void bpkRunHitFit::StoreResults(std::vector<char>& payload) const
+  {
+    // Per result: the permutation, the fit quantities and the fitted
+    // momenta; the unfitted event is rebuilt from the permutation.
+    payload.clear();
+    Put(payload,uint32_t(_Fit_Results.size()));
+    Put(payload,uint32_t(_jetInputs.size()));
+    for (size_t i = 0 ; i != _Fit_Results.size(); i++) {
+      const Compact_Fit_Result& r = _Fit_Results[i];
+      const std::vector<int>& jet_types = _candidates[_Fit_Candidates[i]];
+      Put(payload,int32_t(_Fit_Codes[i]));
+      Put(payload,int32_t(_Fit_Candidates[i]));
+      Put(payload,_Fit_Degenerate[i]);
+      for (size_t j = 0 ; j != jet_types.size(); j++) {
+	Put(payload,int8_t(jet_types[j]));
+      }
+      Put(payload,r.chisq());
+      Put(payload,r.umwhad());
+      Put(payload,r.utmass());
+      Put(payload,r.mt());
+      Put(payload,r.sigmt());
+      PutVector(payload,r.pullx());
+      PutVector(payload,r.pully());
+      const Compact_Event& c = r.ev();
+      Put(payload,uint32_t(c.nobjs()));
+      for (size_t k = 0 ; k != c.nobjs(); k++) {
+	PutFourvec(payload,c.p(k));
+      }
+      PutFourvec(payload,c.met());
+    }
+  }
+
+  bool bpkRunHitFit::LoadResults(const std::vector<char>& payload)
+  {
+    const char* p   = payload.empty() ? 0 : &payload[0];
+    const char* end = p + payload.size();
+
+    uint32_t nresults, njets;
+    if (!Get(p,end,nresults) || !Get(p,end,njets) || njets != _jetInputs.size()) return false;
+
+    std::vector<int>& jet_types = _jet_types;
+    jet_types.resize(njets);
+    for (uint32_t i = 0 ; i != nresults; i++) {
+      int32_t code, candidate;
+      char degenerate;
+      if (!Get(p,end,code) || !Get(p,end,candidate) || !Get(p,end,degenerate)) return false;
+      for (uint32_t j = 0 ; j != njets; j++) {
+	int8_t type;
+	if (!Get(p,end,type)) return false;
+	jet_types[j] = type;
+      }
+      double chisq, umwhad, utmass, mt, sigmt;
+      if (!Get(p,end,chisq) || !Get(p,end,umwhad) || !Get(p,end,utmass) ||
+	  !Get(p,end,mt) || !Get(p,end,sigmt)) return false;
+      if (!GetVector(p,end,_pullx) || !GetVector(p,end,_pully)) return false;
+
+      BuildCompact(jet_types,_compactSource,_builtCompact);
+      _Unfitted_Events.push_back(_builtCompact);
+
+      uint32_t nobjs;
+      if (!Get(p,end,nobjs) || nobjs != _builtCompact.nobjs()) return false;
+      Fourvec v;
+      for (uint32_t k = 0 ; k != nobjs; k++) {
+	if (!GetFourvec(p,end,v)) return false;
+	_builtCompact.set_p(k,v);
+      }
+      if (!GetFourvec(p,end,_builtCompact.met())) return false;
+
+      _Fit_Results.extend().assign(chisq,_builtCompact,_pullx,_pully,umwhad,utmass,mt,sigmt);
+      _Fit_Codes.push_back(code);
+      _Fit_Candidates.push_back(candidate);
+      _Fit_Degenerate.push_back(degenerate);
+    }
+    return p == end;
   }
 
   std::vector<Lepjets_Event> bpkRunHitFit::GetUnfittedEvent()
   {
-    return _Unfitted_Events;
+    std::vector<Lepjets_Event> events(_Unfitted_Events.size(), Lepjets_Event(0,0));
+    for (size_t i = 0 ; i != _Unfitted_Events.size(); i++) {
+      _Unfitted_Events[i].to_event(_compactSource,events[i]);
+    }
+    return events;
   }
 
   std::vector<Fit_Result> bpkRunHitFit::GetFitAllPermutation()
   {
-    return _Fit_Results;
+    std::vector<Fit_Result> results;
+    for (size_t i = 0 ; i != _Fit_Results.size(); i++) {
+      results.push_back(MakeResult(_Fit_Results[i],_compactSource));
+    }
+    return results;
+  }
+
+  std::vector<Fit_Result>::size_type bpkRunHitFit::NumFitResults() const
+  {
+    return _Fit_Results.size();
+  }
+
+  const Fit_Result& bpkRunHitFit::GetFitResult(std::vector<Fit_Result>::size_type i) const
+  {
+    return MakeResult(_Fit_Results[i],_compactSource);
+  }
+
+  const Compact_Fit_Result& bpkRunHitFit::GetCompactResult(std::vector<Fit_Result>::size_type i) const
+  {
+    return _Fit_Results[i];
+  }
+
+  const Fit_Result& bpkRunHitFit::MakeResult(const Compact_Fit_Result& r,
+					     const Lepjets_Event& source) const
+  {
+    r.to_result(source,_result,_resultEv);
+    return _result;
+  }
+
+  const Lepjets_Event& bpkRunHitFit::GetUnfittedEvent(std::vector<Fit_Result>::size_type i) const
+  {
+    _Unfitted_Events[i].to_event(_compactSource,_unfittedEv);
+    return _unfittedEv;
+  }
+
+  int bpkRunHitFit::GetPermutationCode(std::vector<Fit_Result>::size_type i) const
+  {
+    return _Fit_Codes[i];
+  }
+
+  int bpkRunHitFit::PermutationCode(const std::vector<int>& jet_types, int nusol)
+  {
+    return 2*jetPermutationCode(jet_types) + nusol;
   }
 
 } // namespace hitfit
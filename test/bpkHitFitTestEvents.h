@@ -0,0 +1,77 @@
+#ifndef BPKHITFITTESTEVENTS
+#define BPKHITFITTESTEVENTS
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkHitFitInput.h"
+
+namespace hitfit{
+
+  // Fixed synthetic events for the tests: a muon, the MET and six or
+  // seven jets close to a t+g event, with one b tag for odd evnum and
+  // two for even.
+
+  inline bpkHitFitJet MakeTestJet(double pt, double eta, double phi, double m, bool btag)
+  {
+    bpkHitFitJet jet;
+    const double pz = pt*std::sinh(eta);
+    jet.Px  = pt*std::cos(phi);
+    jet.Py  = pt*std::sin(phi);
+    jet.Pz  = pz;
+    jet.Energy = std::sqrt(pt*pt + pz*pz + m*m);
+    jet.Eta = eta;
+    jet.Pt  = pt;
+    // Corrections of a few percent, different for b and light jets
+    jet.PtCorrL7b   = 1.04*pt;
+    jet.PtCorrL7uds = 0.98*pt;
+    jet.PtCorrL3    = pt;
+    jet.BTagDiscr   = btag ? 0.9 : 0.1;
+    jet.isBTag      = btag;
+    return jet;
+  }
+
+  inline bpkHitFitInput MakeTestEvent(int evnum, int njets)
+  {
+    bpkHitFitInput input;
+    input.runnum = 1;
+    input.evnum  = evnum;
+
+    bpkHitFitLepton mu;
+    mu.Px = 45.; mu.Py = -12.; mu.Pz = 20.;
+    mu.Energy = std::sqrt(45.*45. + 12.*12. + 20.*20.);
+    mu.Eta = std::asinh(20./std::sqrt(45.*45. + 12.*12.));
+    mu.LeptonType = 13;
+    input.leptons.push_back(mu);
+
+    // lepb, hadb, two W jets, two gluons and an ISR jet, in a fixed
+    // but not pT-ordered sequence
+    const double pt[]  = { 95., 120., 60., 48., 150., 80., 32. };
+    const double eta[] = { 0.3, -0.8, 1.1, -0.2, 0.6, -1.4, 1.8 };
+    const double phi[] = { 2.6, -0.4, 0.9, -2.0, -2.8, 1.7, 0.2 };
+    const double m[]   = { 8., 10., 6., 5., 12., 9., 4. };
+    const bool btag[]  = { true, evnum % 2 == 0, false, false, false, false, false };
+    for (int j = 0 ; j != njets; j++) {
+      input.jets.push_back(MakeTestJet(pt[j], eta[j], phi[j] + 0.1*evnum, m[j], btag[j]));
+    }
+
+    input.PFMETx = -70. + 5.*evnum;
+    input.PFMETy = 35.;
+    input.PFMET  = std::sqrt(input.PFMETx*input.PFMETx + input.PFMETy*input.PFMETy);
+    return input;
+  }
+
+  // The default file given as first argument, or the one of TopHitFit
+  // under $CMSSW_BASE; empty if neither is there.
+  inline std::string TestDefaultFile(int argc, char* argv[])
+  {
+    if (argc > 1) return argv[1];
+    const char* base = getenv("CMSSW_BASE");
+    if (!base) return std::string();
+    return std::string(base) + "/src/TopQuarkAnalysis/TopHitFit/data/setting/RunHitFitConfiguration.txt";
+  }
+
+} // namespace hitfit
+
+#endif // #ifndef BPKHITFITTESTEVENTS
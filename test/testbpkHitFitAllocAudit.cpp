@@ -0,0 +1,65 @@
+// Allocation audit of the permutation loop of bpkRunHitFit.
+//
+// Fits the fixed test events in turn, the largest first, so that every
+// later event finds the buffers of the fitter at their size, and checks
+// that these steady-state events allocate nothing in the permutation
+// loop: bpkHitFitAllocAudit::steady_loop_allocs must be 0.  This runs
+// with lazy pulls off, where every result slot takes pulls.
+//
+// Only meaningful with the package built with BPKHITFIT_ALLOC_AUDIT;
+// otherwise nothing is counted and the test passes after saying so.
+//
+// Usage: testbpkHitFitAllocAudit [default_file]
+
+#include <iostream>
+#include <string>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+#include "MyAna/bpkHitFitForExcitedQuark/test/bpkHitFitTestEvents.h"
+
+using namespace hitfit;
+
+int main(int argc, char* argv[])
+{
+  if (!bpkHitFitAllocCount::Enabled()) {
+    std::cout << "built without BPKHITFIT_ALLOC_AUDIT, nothing to check" << std::endl;
+    return 0;
+  }
+
+  const std::string default_file = TestDefaultFile(argc, argv);
+  if (default_file.empty()) {
+    std::cerr << "CMSSW_BASE is not set" << std::endl;
+    return 1;
+  }
+
+  LeptonTranslator lepTr;
+  JetTranslator    jetTr;
+  METTranslator    metTr;
+  bpkRunHitFit runner(lepTr, jetTr, metTr, default_file, 80.4, 80.4, 172.5);
+  runner.SetAllocAudit(true);
+
+  // Seven jets with two b tags has the most permutations; then all of
+  // them twice.
+  runner.FitEvent(MakeTestEvent(4, 7));
+  for (int pass = 0 ; pass != 2; pass++) {
+    for (int evnum = 1 ; evnum <= 4; evnum++) {
+      runner.FitEvent(MakeTestEvent(evnum, evnum <= 2 ? 6 : 7));
+    }
+  }
+
+  const bpkHitFitAllocAudit& audit = runner.AllocAudit();
+  audit.dump(std::cout);
+
+  const unsigned long expected_steady_loop_allocs = 0;
+  if (audit.steady_events == 0) {
+    std::cerr << "no steady-state events" << std::endl;
+    return 1;
+  }
+  if (audit.steady_loop_allocs != expected_steady_loop_allocs || !audit.SteadyStateAllocFree()) {
+    std::cerr << audit.steady_loop_allocs << " allocations in the permutation loop over "
+	      << audit.steady_events << " steady-state events, expected "
+	      << expected_steady_loop_allocs << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+// Regression fixture for the default fit path of bpkRunHitFit.
+//
+// A few fixed synthetic events are fitted by bpkRunHitFit::FitEvent()
+// with the default settings, and again by the loop bpkRunHitFit ran
+// before the per-event translation, the compact results and the
+// permutation tables: for every jet permutation passing the b-tag
+// requirement and every neutrino solution, copy the event, add the jets
+// translated for their assumed type and call
+// TopGluon_Fit::fit_one_perm().  Both must fit the same permutations,
+// with the same chisq, masses and fitted momenta.
+//
+// Usage: testbpkRunHitFitRegression [default_file]
+// The resolution files are taken from $CMSSW_BASE, as by the default
+// translators; the default file defaults to the one of TopHitFit.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MyAna/bpkHitFitForExcitedQuark/interface/bpkRunHitFit.h"
+#include "TopQuarkAnalysis/TopHitFit/interface/Defaults_Text.h"
+#include "MyAna/bpkHitFitForExcitedQuark/test/bpkHitFitTestEvents.h"
+
+using namespace hitfit;
+
+namespace {
+
+  const double LEPW_MASS = 80.4;
+  const double HADW_MASS = 80.4;
+  const double TOP_MASS  = 172.5;
+
+  // Relative tolerance of the comparisons; the two paths sum the
+  // objects in a different order.
+  const double TOLERANCE = 1e-6;
+
+  struct Baseline {
+    double chisq, mt, sigmt, umwhad, utmass;
+    Lepjets_Event ev;
+  };
+
+  // The fits of the original FitAllPermutation(), by permutation code.
+  std::map<int, Baseline> FitBaseline(const bpkHitFitInput& input,
+				      LeptonTranslator& lepTr,
+				      JetTranslator& jetTr,
+				      METTranslator& metTr,
+				      TopGluon_Fit& fitter)
+  {
+    std::map<int, Baseline> results;
+
+    Lepjets_Event event(input.runnum, input.evnum);
+    for (size_t i = 0 ; i != input.leptons.size(); i++) {
+      event.add_lep(lepTr(input.leptons[i], lepton_label));
+    }
+    event.met()    = metTr(input);
+    event.kt_res() = metTr.KtResolution(input);
+
+    const size_t njets = input.jets.size();
+    std::vector<int> jet_types(njets, unknown_label);
+    jet_types[0] = lepb_label;
+    jet_types[1] = hadb_label;
+    jet_types[2] = hadw1_label;
+    jet_types[3] = hadw1_label;
+    jet_types[4] = gluon1_label;
+    jet_types[5] = gluon2_label;
+    std::stable_sort(jet_types.begin(), jet_types.end());
+
+    int nbtag_jets = 0;
+    for (size_t j = 0 ; j != njets; j++) {
+      if (input.jets[j].isBTag) nbtag_jets++;
+    }
+
+    do {
+      int nbtag = 0;
+      for (size_t j = 0 ; j != njets; j++) {
+	if ((jet_types[j] == lepb_label || jet_types[j] == hadb_label) && input.jets[j].isBTag) nbtag++;
+      }
+      if (nbtag_jets <= 1 && nbtag < 1) continue;
+      if (nbtag_jets > 1 && nbtag < 2) continue;
+
+      for (int nusol = 0 ; nusol != 2; nusol++) {
+	bool nuz = bool(nusol);
+	Lepjets_Event fev = event;
+	for (size_t j = 0 ; j != njets; j++) {
+	  fev.add_jet(jetTr(input.jets[j], jet_types[j]));
+	}
+	fev.set_jet_types(jet_types);
+
+	Baseline b = { -999, 0, 0, 0, 0, fev };
+	Column_Vector pullx, pully;
+	b.chisq = fitter.fit_one_perm(fev, nuz, b.umwhad, b.utmass, b.mt, b.sigmt, pullx, pully);
+	b.ev = fev;
+	results.insert(std::make_pair(bpkRunHitFit::PermutationCode(jet_types, nusol), b));
+      }
+    } while (std::next_permutation(jet_types.begin(), jet_types.end()));
+
+    return results;
+  }
+
+  bool Close(double a, double b)
+  {
+    return std::fabs(a - b) <= TOLERANCE*std::max(1., std::max(std::fabs(a), std::fabs(b)));
+  }
+
+  bool Close(const Fourvec& a, const Fourvec& b)
+  {
+    return Close(a.x(), b.x()) && Close(a.y(), b.y()) && Close(a.z(), b.z()) && Close(a.e(), b.e());
+  }
+
+  int Compare(const bpkHitFitInput& input, bpkRunHitFit& runner,
+	      const std::map<int, Baseline>& baseline)
+  {
+    int failures = 0;
+    const size_t n = runner.FitEvent(input);
+    if (n != baseline.size()) {
+      std::cerr << "event " << input.evnum << ": " << n << " results, baseline "
+		<< baseline.size() << std::endl;
+      return 1;
+    }
+
+    for (size_t i = 0 ; i != n; i++) {
+      const int code = runner.GetPermutationCode(i);
+      std::map<int, Baseline>::const_iterator it = baseline.find(code);
+      if (it == baseline.end()) {
+	std::cerr << "event " << input.evnum << ": permutation " << code
+		  << " not in the baseline" << std::endl;
+	failures++;
+	continue;
+      }
+      const Baseline& b = it->second;
+      const Fit_Result& r = runner.GetFitResult(i);
+
+      bool ok = Close(r.chisq(), b.chisq) && Close(r.mt(), b.mt) && Close(r.sigmt(), b.sigmt)
+	&& Close(r.umwhad(), b.umwhad) && Close(r.utmass(), b.utmass)
+	&& r.ev().njets() == b.ev.njets() && Close(r.ev().met(), b.ev.met());
+      for (size_t j = 0 ; ok && j != b.ev.nleps(); j++) {
+	ok = Close(r.ev().lep(j).p(), b.ev.lep(j).p());
+      }
+      for (size_t j = 0 ; ok && j != b.ev.njets(); j++) {
+	ok = r.ev().jet(j).type() == b.ev.jet(j).type() && Close(r.ev().jet(j).p(), b.ev.jet(j).p());
+      }
+      if (!ok) {
+	std::cerr << "event " << input.evnum << ", permutation " << code
+		  << ": chisq " << r.chisq() << " mt " << r.mt()
+		  << ", baseline chisq " << b.chisq << " mt " << b.mt << std::endl;
+	failures++;
+      }
+    }
+    return failures;
+  }
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string default_file = TestDefaultFile(argc, argv);
+  if (default_file.empty()) {
+    std::cerr << "CMSSW_BASE is not set" << std::endl;
+    return 1;
+  }
+
+  LeptonTranslator lepTr;
+  JetTranslator    jetTr;
+  METTranslator    metTr;
+
+  bpkRunHitFit runner(lepTr, jetTr, metTr, default_file, LEPW_MASS, HADW_MASS, TOP_MASS);
+  TopGluon_Fit fitter(TopGluon_Fit_Args(Defaults_Text(default_file)), LEPW_MASS, HADW_MASS, TOP_MASS);
+
+  // Six and seven jets, with one and two b tags
+  int failures = 0;
+  int nfits = 0;
+  for (int evnum = 1 ; evnum <= 4; evnum++) {
+    const bpkHitFitInput input = MakeTestEvent(evnum, evnum <= 2 ? 6 : 7);
+    const std::map<int, Baseline> baseline = FitBaseline(input, lepTr, jetTr, metTr, fitter);
+    failures += Compare(input, runner, baseline);
+    nfits += baseline.size();
+  }
+
+  if (nfits == 0) {
+    std::cerr << "no permutations fitted" << std::endl;
+    return 1;
+  }
+  std::cout << nfits << " fits compared, " << failures << " differences" << std::endl;
+  return failures == 0 ? 0 : 1;
+}